@@ -0,0 +1,154 @@
+#include "batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LIFE_NEIGHBORS 8
+
+bool initBoardBatch(BoardBatch *batch, int width, int height, int boardCount,
+                    const Rule *rule) {
+  *batch = (BoardBatch){0};
+  if (rule->numStates != 2 || !isLifeLikeNeighborhood(rule) || boardCount < 1)
+    return false;
+
+  batch->width = width;
+  batch->height = height;
+  batch->boardCount = boardCount;
+  batch->groupCount = (boardCount + BATCH_LANES - 1) / BATCH_LANES;
+  batch->stride = width + 2;
+  batch->planeSize = (size_t)batch->stride * (height + 2);
+  for (int count = 0; count <= LIFE_NEIGHBORS; count++) {
+    batch->birthCounts |= (uint16_t)(rule->birth[count] << count);
+    batch->survivalCounts |= (uint16_t)(rule->survival[count] << count);
+  }
+
+  size_t laneCount = batch->planeSize * batch->groupCount;
+  batch->lanes = calloc(laneCount, sizeof(uint64_t));
+  batch->nextLanes = calloc(laneCount, sizeof(uint64_t));
+  batch->columnSums = malloc(2 * (width + 2) * sizeof(uint64_t));
+  if (!batch->lanes || !batch->nextLanes || !batch->columnSums) {
+    freeBoardBatch(batch);
+    return false;
+  }
+  return true;
+}
+
+void freeBoardBatch(BoardBatch *batch) {
+  free(batch->lanes);
+  free(batch->nextLanes);
+  free(batch->columnSums);
+  *batch = (BoardBatch){0};
+}
+
+void loadBatchBoard(BoardBatch *batch, int index, const Board *board) {
+  for (int y = 0; y < batch->height; y++) {
+    const uint8_t *row = getBoardCell(board, 0, y);
+    for (int x = 0; x < batch->width; x++)
+      setBatchCell(batch, index, x, y, row[x] != 0);
+  }
+}
+
+void storeBatchBoard(const BoardBatch *batch, int index, Board *board) {
+  for (int y = 0; y < batch->height; y++) {
+    uint8_t *row = getBoardCell(board, 0, y);
+    for (int x = 0; x < batch->width; x++)
+      row[x] = isBatchCellAlive(batch, index, x, y);
+  }
+  rehashBoard(board);
+}
+
+// Copies the edge rows and columns of a plane into its ghost border, as for
+// a Board.
+static void wrapGhostBorder(const BoardBatch *batch, uint64_t *plane) {
+  int width = batch->width, height = batch->height;
+  ptrdiff_t stride = batch->stride;
+  uint64_t *first = plane + stride + 1;
+
+  for (int y = 0; y < height; y++) {
+    uint64_t *row = first + y * stride;
+    row[-1] = row[width - 1];
+    row[width] = row[0];
+  }
+  memcpy(first - stride - 1, first + (height - 1) * stride - 1,
+         (width + 2) * sizeof(uint64_t));
+  memcpy(first + height * stride - 1, first - 1,
+         (width + 2) * sizeof(uint64_t));
+}
+
+// Steps one plane with the same column sums as the byte kernel, but in
+// binary: each column of three is summed into two bit words by a full adder,
+// then three columns are added into the four bits of the neighbor count,
+// which is compared against every count of the rule.
+static void stepPlane(BoardBatch *batch, const uint64_t *plane,
+                      uint64_t *nextPlane) {
+  int width = batch->width;
+  ptrdiff_t stride = batch->stride;
+  uint64_t *lowSums = batch->columnSums, *highSums = lowSums + width + 2;
+  uint16_t ruleCounts = batch->birthCounts | batch->survivalCounts;
+
+  for (int y = 0; y < batch->height; y++) {
+    // Rows start at the ghost cell left of x = 0.
+    const uint64_t *row = plane + (y + 1) * stride;
+    const uint64_t *above = row - stride, *below = row + stride;
+    for (int x = 0; x < width + 2; x++) {
+      uint64_t outer = above[x] ^ below[x];
+      lowSums[x] = outer ^ row[x];
+      highSums[x] = (above[x] & below[x]) | (outer & row[x]);
+    }
+
+    uint64_t *next = nextPlane + (y + 1) * stride + 1;
+    for (int x = 0; x < width; x++) {
+      // The middle column counts without the cell itself.
+      uint64_t cell = row[x + 1];
+      uint64_t middleLow = above[x + 1] ^ below[x + 1];
+      uint64_t middleHigh = above[x + 1] & below[x + 1];
+
+      uint64_t left = lowSums[x], right = lowSums[x + 2];
+      uint64_t bit0 = left ^ middleLow ^ right;
+      uint64_t carry = (left & middleLow) | (right & (left ^ middleLow));
+      uint64_t leftHigh = highSums[x], rightHigh = highSums[x + 2];
+      uint64_t twos = leftHigh ^ middleHigh ^ rightHigh;
+      uint64_t fours =
+          (leftHigh & middleHigh) | (rightHigh & (leftHigh ^ middleHigh));
+      uint64_t bit1 = twos ^ carry;
+      uint64_t bit2 = fours ^ (twos & carry);
+      uint64_t bit3 = fours & twos & carry;
+
+      uint64_t born = 0, kept = 0;
+      for (int count = 0; count <= LIFE_NEIGHBORS; count++) {
+        if (!(ruleCounts >> count & 1))
+          continue;
+        uint64_t isCount = ~((bit0 ^ -(uint64_t)(count & 1)) |
+                             (bit1 ^ -(uint64_t)(count >> 1 & 1)) |
+                             (bit2 ^ -(uint64_t)(count >> 2 & 1)) |
+                             (bit3 ^ -(uint64_t)(count >> 3 & 1)));
+        born |= isCount & -(uint64_t)(batch->birthCounts >> count & 1);
+        kept |= isCount & -(uint64_t)(batch->survivalCounts >> count & 1);
+      }
+      next[x] = (~cell & born) | (cell & kept);
+    }
+  }
+}
+
+void stepBoardBatch(BoardBatch *batch, int generations) {
+  // Each group's plane stays in cache through all of its generations.
+  for (int group = 0; group < batch->groupCount; group++) {
+    uint64_t *plane = batch->lanes + group * batch->planeSize;
+    uint64_t *nextPlane = batch->nextLanes + group * batch->planeSize;
+    for (int generation = 0; generation < generations; generation++) {
+      wrapGhostBorder(batch, plane);
+      stepPlane(batch, plane, nextPlane);
+      uint64_t *previous = plane;
+      plane = nextPlane;
+      nextPlane = previous;
+    }
+  }
+
+  // Every group ends up in the same buffer.
+  if (generations % 2) {
+    uint64_t *previous = batch->lanes;
+    batch->lanes = batch->nextLanes;
+    batch->nextLanes = previous;
+  }
+  batch->generation += generations;
+}
@@ -0,0 +1,64 @@
+#ifndef GOL_BATCH_H
+#define GOL_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+#include "rule.h"
+
+#define BATCH_LANES 64 // Boards per word
+
+// Many small boards of one size and rule, stepped together. Boards are
+// bit-sliced: each group of 64 boards is a plane of words laid out like a
+// Board, with bit i of every word holding a cell of board i of the group, so
+// one bitwise operation steps the same cell of 64 boards. Like a Board, each
+// plane has a ghost border so that every board wraps around.
+//
+// Only two-state rules of the 8 neighbor Moore neighborhood are supported.
+typedef struct {
+  int width, height;
+  int boardCount, groupCount;
+  ptrdiff_t stride;  // Words between rows, including the ghost border
+  size_t planeSize;  // Words in the plane of a group
+  uint64_t *lanes;     // Current generation, one plane per group
+  uint64_t *nextLanes; // Back buffer the next generation is written into
+  uint64_t *columnSums; // Per-row scratch of the kernel, two bits per column
+  uint16_t birthCounts, survivalCounts; // Bit n set when n neighbors do
+  uint64_t generation;
+} BoardBatch;
+
+// Sets up `boardCount` dead boards. Returns false for unsupported rules or
+// when out of memory.
+bool initBoardBatch(BoardBatch *batch, int width, int height, int boardCount,
+                    const Rule *rule);
+void freeBoardBatch(BoardBatch *batch);
+
+static inline uint64_t *getBatchWord(const BoardBatch *batch, int index, int x,
+                                     int y) {
+  return &batch->lanes[(size_t)(index / BATCH_LANES) * batch->planeSize +
+                       (y + 1) * batch->stride + x + 1];
+}
+
+static inline bool isBatchCellAlive(const BoardBatch *batch, int index, int x,
+                                    int y) {
+  return *getBatchWord(batch, index, x, y) >> (index % BATCH_LANES) & 1;
+}
+
+static inline void setBatchCell(BoardBatch *batch, int index, int x, int y,
+                                bool isAlive) {
+  uint64_t *word = getBatchWord(batch, index, x, y);
+  uint64_t bit = (uint64_t)1 << (index % BATCH_LANES);
+  *word = isAlive ? *word | bit : *word & ~bit;
+}
+
+// Copies the cells of a board of the batch's size in and out of the batch.
+// Copying out keeps the board's generation, and rehashes it.
+void loadBatchBoard(BoardBatch *batch, int index, const Board *board);
+void storeBatchBoard(const BoardBatch *batch, int index, Board *board);
+
+// Advances every board of the batch by a number of generations.
+void stepBoardBatch(BoardBatch *batch, int generations);
+
+#endif // GOL_BATCH_H
@@ -0,0 +1,420 @@
+#include "board.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define LIFE_NEIGHBORS 8
+
+// Allocates the planes and scratch space, except for a current plane that is
+// already given.
+static bool allocateBoard(Board *board, int width, int height,
+                          const Rule *rule, uint8_t *cells) {
+  board->width = width;
+  board->height = height;
+  board->stride = width + 2;
+  board->rule = *rule;
+
+  size_t planeSize = (size_t)board->stride * (height + 2);
+  board->cells = cells ? cells : calloc(planeSize, 1);
+  board->nextCells = calloc(planeSize, 1);
+  board->tileColumns = (width + BOARD_TILE_SIZE - 1) / BOARD_TILE_SIZE;
+  board->tileRows = (height + BOARD_TILE_SIZE - 1) / BOARD_TILE_SIZE;
+  board->changedTiles = malloc((size_t)board->tileColumns * board->tileRows);
+  bool ok = board->cells && board->nextCells && board->changedTiles;
+
+  if (isLifeLikeNeighborhood(rule)) {
+    board->columnSums = malloc(width + 2);
+    ok = ok && board->columnSums;
+  } else {
+    board->counts = malloc((size_t)width * height * sizeof(uint16_t));
+    ok = ok && board->counts &&
+         initRangeCounter(&board->rangeCounter, width, height, rule);
+  }
+
+  if (!ok) {
+    freeBoard(board);
+    return false;
+  }
+
+  // A new plane is all dead, which hashes to 0. A given one comes with its
+  // hash and stats, so that it isn't read in just to compute them.
+  if (!cells)
+    board->stats = (BoardStats){.left = -1, .top = -1, .right = -1,
+                                .bottom = -1};
+  memset(board->changedTiles, 1, (size_t)board->tileColumns * board->tileRows);
+  return true;
+}
+
+bool initBoard(Board *board, int width, int height, const Rule *rule) {
+  *board = (Board){0};
+  return allocateBoard(board, width, height, rule, nullptr);
+}
+
+bool initMappedBoard(Board *board, int width, int height, const Rule *rule,
+                     void *mapping, size_t mappingSize, size_t planeOffset) {
+  *board = (Board){
+      .mapping = mapping,
+      .mappingSize = mappingSize,
+  };
+  return allocateBoard(board, width, height, rule,
+                       (uint8_t *)mapping + planeOffset);
+}
+
+static bool isMappedPlane(const Board *board, const uint8_t *plane) {
+  const uint8_t *mapping = board->mapping;
+  return mapping && plane >= mapping && plane < mapping + board->mappingSize;
+}
+
+void freeBoard(Board *board) {
+  if (!isMappedPlane(board, board->cells))
+    free(board->cells);
+  if (!isMappedPlane(board, board->nextCells))
+    free(board->nextCells);
+  if (board->mapping)
+    munmap(board->mapping, board->mappingSize);
+  free(board->changedTiles);
+  free(board->ages);
+  free(board->columnSums);
+  free(board->counts);
+  freeRangeCounter(&board->rangeCounter);
+  *board = (Board){0};
+}
+
+void clearBoard(Board *board) {
+  memset(board->cells, 0, (size_t)board->stride * (board->height + 2));
+  board->generation = 0;
+  board->hash = 0;
+  board->stats = (BoardStats){.left = -1, .top = -1, .right = -1, .bottom = -1};
+  memset(board->changedTiles, 1, (size_t)board->tileColumns * board->tileRows);
+  if (board->ages)
+    memset(board->ages, UINT8_MAX, (size_t)board->width * board->height);
+}
+
+bool trackBoardAges(Board *board) {
+  if (!board->ages) {
+    board->ages = malloc((size_t)board->width * board->height);
+    if (!board->ages)
+      return false;
+  }
+  memset(board->ages, UINT8_MAX, (size_t)board->width * board->height);
+  return true;
+}
+
+// Sets bit 7 of each byte of a word that is 0, by the exact form of the zero
+// byte test.
+static inline uint64_t getZeroBytes(uint64_t word) {
+  uint64_t low = 0x7F7F7F7F7F7F7F7Fu;
+  return ~(((word & low) + low) | word) & ~low;
+}
+
+// Sets bit 7 of each byte of a word of cells that is 1, a live cell.
+static inline uint64_t getLiveBytes(uint64_t word) {
+  return getZeroBytes(word ^ 0x0101010101010101u);
+}
+
+// Counts the live cells of the next generation of a row, and the cells born
+// and died on the way, in a word at a time.
+typedef struct {
+  uint64_t change; // To the hash
+  uint64_t population, births, deaths;
+  int left, right; // Bounds of the live cells, -1 if none
+} RowScan;
+
+// Returns whether the word changed.
+static inline bool scanWord(RowScan *scan, size_t wordIndex,
+                            uint64_t currentWord, uint64_t nextWord) {
+  uint64_t live = getLiveBytes(nextWord);
+  bool isChanged = currentWord != nextWord;
+  if (isChanged) {
+    uint64_t wasLive = getLiveBytes(currentWord);
+    scan->change ^=
+        getWordKey(wordIndex, currentWord) ^ getWordKey(wordIndex, nextWord);
+    scan->births += __builtin_popcountll(live & ~wasLive);
+    scan->deaths += __builtin_popcountll(wasLive & ~live);
+  }
+  scan->population += __builtin_popcountll(live);
+  return isChanged;
+}
+
+// Finds the first and last live cell of a row that has some, searching from
+// both ends a word at a time. Keeping track of them while scanning costs more
+// than this second look at a row that is still in cache.
+static void findRowBounds(const uint8_t *row, int width, int *left,
+                          int *right) {
+  uint64_t live;
+  int x = 0;
+  while (!(live = getLiveBytes(loadCellWord(row, x, width))))
+    x += 8;
+  *left = x + __builtin_ctzll(live) / 8;
+  x = (width - 1) & ~7;
+  while (!(live = getLiveBytes(loadCellWord(row, x, width))))
+    x -= 8;
+  *right = x + (63 - __builtin_clzll(live)) / 8;
+}
+
+// Scans a row's change from the current to the next generation, rehashing
+// only the words that differ and marking their tiles changed.
+static RowScan scanRowChange(const Board *board, int y,
+                             const uint8_t *current, const uint8_t *next) {
+  int width = board->width;
+  size_t wordIndex = getWordIndex(board, 0, y);
+  uint8_t *tiles =
+      &board->changedTiles[(y / BOARD_TILE_SIZE) * board->tileColumns];
+  RowScan scan = {.left = -1, .right = -1};
+  int x = 0;
+  for (; x + 8 <= width; x += 8, wordIndex++) {
+    uint64_t currentWord, nextWord;
+    memcpy(&currentWord, current + x, 8);
+    memcpy(&nextWord, next + x, 8);
+    if (scanWord(&scan, wordIndex, currentWord, nextWord))
+      tiles[x / BOARD_TILE_SIZE] = 1;
+  }
+  if (x < width && scanWord(&scan, wordIndex, loadCellWord(current, x, width),
+                            loadCellWord(next, x, width)))
+    tiles[x / BOARD_TILE_SIZE] = 1;
+
+  // Through locals, so that the scan never has its address taken and stays
+  // in registers.
+  if (scan.population) {
+    int left, right;
+    findRowBounds(next, width, &left, &right);
+    scan.left = left;
+    scan.right = right;
+  }
+  return scan;
+}
+
+// Ages a word of cells a generation, restarting the ones that changed and
+// holding the ones at UINT8_MAX. `change` is the current word XOR the next.
+static inline uint64_t ageWord(uint64_t age, uint64_t change) {
+  uint64_t ones = 0x0101010101010101u;
+  uint64_t isSettled = getZeroBytes(~age) >> 7;
+  uint64_t isChanged = (~getZeroBytes(change) >> 7) & ones;
+  return (age + (~isSettled & ones)) & ~(isChanged * 0xFF);
+}
+
+// Ages a row's cells while it is still in cache, a word at a time.
+static void ageRow(uint8_t *ages, const uint8_t *current, const uint8_t *next,
+                   int width) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    uint64_t age, currentWord, nextWord;
+    memcpy(&age, ages + x, 8);
+    memcpy(&currentWord, current + x, 8);
+    memcpy(&nextWord, next + x, 8);
+    age = ageWord(age, currentWord ^ nextWord);
+    memcpy(ages + x, &age, 8);
+  }
+  for (; x < width; x++) {
+    uint8_t age = ages[x] + (ages[x] != UINT8_MAX);
+    ages[x] = current[x] == next[x] ? age : 0;
+  }
+}
+
+// Adds the scan of row y to the stats of the board being scanned, which start
+// out like a cleared board's.
+static void addRowScan(BoardStats *stats, int y, const RowScan *scan) {
+  stats->population += scan->population;
+  stats->births += scan->births;
+  stats->deaths += scan->deaths;
+  if (scan->left < 0)
+    return;
+  if (stats->top < 0) {
+    stats->top = y;
+    stats->left = scan->left;
+    stats->right = scan->right;
+  }
+  stats->bottom = y;
+  stats->left = scan->left < stats->left ? scan->left : stats->left;
+  stats->right = scan->right > stats->right ? scan->right : stats->right;
+}
+
+void rehashBoard(Board *board) {
+  // Each row is scanned as if born from dead cells, which gives its hash and
+  // live cells; the births are dropped.
+  BoardStats stats = {.left = -1, .top = -1, .right = -1, .bottom = -1};
+  uint64_t hash = 0;
+  for (int y = 0; y < board->height; y++) {
+    const uint8_t *row = getBoardCell(board, 0, y);
+    RowScan scan = {.left = -1, .right = -1};
+    for (int x = 0; x < board->width; x += 8)
+      scanWord(&scan, getWordIndex(board, x, y), 0,
+               loadCellWord(row, x, board->width));
+    if (scan.population)
+      findRowBounds(row, board->width, &scan.left, &scan.right);
+    scan.births = 0;
+    hash ^= scan.change;
+    addRowScan(&stats, y, &scan);
+  }
+  board->hash = hash;
+  board->stats = stats;
+  memset(board->changedTiles, 1, (size_t)board->tileColumns * board->tileRows);
+  if (board->ages)
+    memset(board->ages, UINT8_MAX, (size_t)board->width * board->height);
+}
+
+// Takes the words under [x, end) of a row out of the hash and population,
+// or puts them back in, which is the same XOR and the opposite sign.
+static void rescanRowWords(Board *board, int x, int end, int y, int sign) {
+  const uint8_t *row = getBoardCell(board, 0, y);
+  size_t wordIndex = getWordIndex(board, x, y);
+  for (int wordX = x & ~7; wordX < end; wordX += 8, wordIndex++) {
+    uint64_t word = loadCellWord(row, wordX, board->width);
+    board->hash ^= getWordKey(wordIndex, word);
+    board->stats.population += sign * __builtin_popcountll(getLiveBytes(word));
+  }
+}
+
+void setBoardRow(Board *board, int x, int y, const uint8_t *states,
+                 int count) {
+  if (count <= 0)
+    return;
+  int end = x + count;
+  uint8_t *row = getBoardCell(board, x, y);
+  rescanRowWords(board, x, end, y, -1);
+  if (board->ages) {
+    uint8_t *ages = getBoardAge(board, x, y);
+    for (int i = 0; i < count; i++)
+      ages[i] = row[i] == states[i] ? ages[i] : 0;
+  }
+  memcpy(row, states, count);
+  rescanRowWords(board, x, end, y, 1);
+
+  uint8_t *tiles =
+      &board->changedTiles[(y / BOARD_TILE_SIZE) * board->tileColumns];
+  for (int tileX = x / BOARD_TILE_SIZE; tileX <= (end - 1) / BOARD_TILE_SIZE;
+       tileX++)
+    tiles[tileX] = 1;
+
+  // Bounds only grow, as with setBoardCell.
+  BoardStats *stats = &board->stats;
+  stats->births = stats->deaths = 0;
+  uint64_t live = 0;
+  for (int i = 0; i < count && !live; i += 8)
+    live = getLiveBytes(loadCellWord(states, i, count));
+  if (!live)
+    return;
+  int left, right;
+  findRowBounds(states, count, &left, &right);
+  left += x;
+  right += x;
+  if (stats->left < 0) {
+    stats->left = left;
+    stats->right = right;
+    stats->top = stats->bottom = y;
+  } else {
+    stats->left = left < stats->left ? left : stats->left;
+    stats->right = right > stats->right ? right : stats->right;
+    stats->top = y < stats->top ? y : stats->top;
+    stats->bottom = y > stats->bottom ? y : stats->bottom;
+  }
+}
+
+// Copies the edge rows and columns into the ghost border on the opposite side
+// so that the board wraps around.
+static void wrapGhostBorder(Board *board) {
+  int width = board->width, height = board->height;
+  ptrdiff_t stride = board->stride;
+  uint8_t *first = getBoardCell(board, 0, 0);
+
+  for (int y = 0; y < height; y++) {
+    uint8_t *row = first + y * stride;
+    row[-1] = row[width - 1];
+    row[width] = row[0];
+  }
+
+  // The ghost rows take the ghost columns along, which fills the corners.
+  memcpy(first - stride - 1, first + (height - 1) * stride - 1, width + 2);
+  memcpy(first + height * stride - 1, first - 1, width + 2);
+}
+
+// Counts the 8 neighbors of a whole row at once: first the live cells of each
+// column of three, then the sums of three neighboring columns. Both loops are
+// plain byte arithmetic over contiguous rows, which compilers vectorize.
+static void stepLifeLikeNeighborhood(Board *board) {
+  const Rule *rule = &board->rule;
+  int width = board->width;
+  ptrdiff_t stride = board->stride;
+  uint8_t *sums = board->columnSums;
+  uint64_t hash = board->hash;
+  BoardStats stats = {.left = -1, .top = -1, .right = -1, .bottom = -1};
+
+  // Two-state rules look up bit (count + 9 * state) of a single mask.
+  uint32_t ruleMask = 0;
+  for (int count = 0; count <= LIFE_NEIGHBORS; count++) {
+    ruleMask |= (uint32_t)rule->birth[count] << count;
+    ruleMask |= (uint32_t)rule->survival[count]
+                << (count + LIFE_NEIGHBORS + 1);
+  }
+
+  for (int y = 0; y < board->height; y++) {
+    // Rows start at the ghost cell left of x = 0.
+    const uint8_t *row = &board->cells[(y + 1) * stride];
+    const uint8_t *above = row - stride, *below = row + stride;
+    for (int x = 0; x < width + 2; x++)
+      sums[x] = (above[x] == 1) + (row[x] == 1) + (below[x] == 1);
+
+    const uint8_t *current = row + 1;
+    uint8_t *next = &board->nextCells[(y + 1) * stride + 1];
+    if (rule->numStates == 2) {
+      for (int x = 0; x < width; x++) {
+        // States past 1 come only from unchecked files, and step like dead
+        // cells rather than shift past the mask.
+        int isAlive = current[x] == 1;
+        int count = sums[x] + sums[x + 1] + sums[x + 2] - isAlive;
+        next[x] = (ruleMask >> (count + (LIFE_NEIGHBORS + 1) * isAlive)) & 1;
+      }
+    } else {
+      for (int x = 0; x < width; x++) {
+        int count = sums[x] + sums[x + 1] + sums[x + 2] - (current[x] == 1);
+        next[x] = getNextCellState(rule, current[x], count);
+      }
+    }
+    if (board->ages)
+      ageRow(getBoardAge(board, 0, y), current, next, width);
+    RowScan scan = scanRowChange(board, y, current, next);
+    hash ^= scan.change;
+    addRowScan(&stats, y, &scan);
+  }
+  board->hash = hash;
+  board->stats = stats;
+}
+
+static void stepOtherNeighborhood(Board *board) {
+  int width = board->width;
+  ptrdiff_t stride = board->stride;
+  uint64_t hash = board->hash;
+  BoardStats stats = {.left = -1, .top = -1, .right = -1, .bottom = -1};
+  countRangeNeighbors(&board->rangeCounter, &board->rule,
+                      getBoardCell(board, 0, 0), stride, board->counts);
+
+  for (int y = 0; y < board->height; y++) {
+    const uint8_t *current = &board->cells[(y + 1) * stride + 1];
+    const uint16_t *counts = &board->counts[(size_t)y * width];
+    uint8_t *next = &board->nextCells[(y + 1) * stride + 1];
+    for (int x = 0; x < width; x++)
+      next[x] = getNextCellState(&board->rule, current[x], counts[x]);
+    if (board->ages)
+      ageRow(getBoardAge(board, 0, y), current, next, width);
+    RowScan scan = scanRowChange(board, y, current, next);
+    hash ^= scan.change;
+    addRowScan(&stats, y, &scan);
+  }
+  board->hash = hash;
+  board->stats = stats;
+}
+
+void stepBoard(Board *board) {
+  if (isLifeLikeNeighborhood(&board->rule)) {
+    wrapGhostBorder(board);
+    stepLifeLikeNeighborhood(board);
+  } else {
+    stepOtherNeighborhood(board);
+  }
+
+  uint8_t *previous = board->cells;
+  board->cells = board->nextCells;
+  board->nextCells = previous;
+  board->generation++;
+}
@@ -0,0 +1,151 @@
+#ifndef GOL_BOARD_H
+#define GOL_BOARD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "neighborhood.h"
+#include "rule.h"
+
+#define BOARD_TILE_SIZE 64 // Cells per side of a tile of changedTiles
+
+// Live cells of a board, and how the last step changed them. Only cells in
+// state 1 count as live; the dying states of Generations rules don't.
+typedef struct {
+  uint64_t population;
+  uint64_t births, deaths; // Of the last step, 0 after other changes
+  int left, top, right, bottom; // Bounds of the live cells, inclusive, or
+                                // -1 when there are none
+} BoardStats;
+
+// The simulation state: one byte per cell, stored row-major in a plane with a
+// one cell ghost border that mirrors the opposite edge, so the board wraps
+// around and every neighbor of an edge cell is a fixed offset away. Render
+// data lives elsewhere so that stepping only streams through states.
+typedef struct {
+  int width, height;
+  ptrdiff_t stride;   // Bytes between rows, including the ghost border
+  uint8_t *cells;     // Current generation
+  uint8_t *nextCells; // Back buffer the next generation is written into
+  Rule rule;
+  uint64_t generation; // Steps since the board was last cleared or loaded
+  uint64_t hash;       // Zobrist hash of the cells, see getWordKey
+  BoardStats stats;    // Kept up to date like the hash
+
+  // A flag per BOARD_TILE_SIZE square of cells, row-major, set whenever any
+  // of its cells change. The board never clears them; whoever catches up on
+  // the changes does, such as the renderer.
+  uint8_t *changedTiles;
+  int tileColumns, tileRows;
+
+  // Generations since each cell last changed, saturating at 255, row-major
+  // without a border. nullptr until trackBoardAges; stepping then ages each
+  // row as it scans it.
+  uint8_t *ages;
+
+  // Snapshot file mapped copy-on-write, which holds one of the planes
+  void *mapping;
+  size_t mappingSize;
+
+  uint8_t *columnSums;       // Per-row scratch of the 8 neighbor kernel
+  uint16_t *counts;          // Neighbor counts of other neighborhoods
+  RangeCounter rangeCounter; // Counts other neighborhoods
+} Board;
+
+bool initBoard(Board *board, int width, int height, const Rule *rule);
+
+// Sets up a board whose current plane is `planeOffset` bytes into a mapped
+// file, which the board unmaps when freed. The hash and stats are left for
+// the caller to set, or to compute with rehashBoard.
+bool initMappedBoard(Board *board, int width, int height, const Rule *rule,
+                     void *mapping, size_t mappingSize, size_t planeOffset);
+void freeBoard(Board *board);
+
+static inline uint8_t *getBoardCell(const Board *board, int x, int y) {
+  return &board->cells[(y + 1) * board->stride + x + 1];
+}
+
+// The hash is Zobrist-style over words of eight cells rather than single
+// cells: the XOR of a key for each word's position and contents, so that
+// stepping only rehashes the words that changed, a word at a time. Keys are
+// mixed rather than kept in a table, and all-dead words have none, so an
+// empty board hashes to 0. Words start every eight cells of a row; the last
+// one of a row may be shorter.
+static inline uint64_t getWordKey(size_t wordIndex, uint64_t word) {
+  uint64_t key = word ^ (wordIndex * 0x9E3779B97F4A7C15u);
+  key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9u;
+  key = (key ^ (key >> 27)) * 0x94D049BB133111EBu;
+  return (key ^ (key >> 31)) & -(uint64_t)(word != 0);
+}
+
+// Reads the word of cells starting at x in a row, with dead cells past the
+// end.
+static inline uint64_t loadCellWord(const uint8_t *row, int x, int width) {
+  uint64_t word = 0;
+  memcpy(&word, row + x, width - x < 8 ? width - x : 8);
+  return word;
+}
+
+static inline uint8_t *getBoardAge(const Board *board, int x, int y) {
+  return &board->ages[(size_t)y * board->width + x];
+}
+
+static inline size_t getWordIndex(const Board *board, int x, int y) {
+  return (size_t)y * ((board->width + 7) / 8) + x / 8;
+}
+
+static inline void markBoardTileChanged(Board *board, int x, int y) {
+  board->changedTiles[(y / BOARD_TILE_SIZE) * board->tileColumns +
+                      x / BOARD_TILE_SIZE] = 1;
+}
+
+// Sets a cell and updates the hash and stats to match. Bounds only grow
+// here, so they may be loose until the next step or rehash.
+static inline void setBoardCell(Board *board, int x, int y, uint8_t state) {
+  const uint8_t *row = getBoardCell(board, 0, y);
+  int wordX = x & ~7;
+  size_t wordIndex = getWordIndex(board, x, y);
+  uint8_t *cell = getBoardCell(board, x, y);
+  board->hash ^= getWordKey(wordIndex, loadCellWord(row, wordX, board->width));
+  board->stats.population += (state == 1) - (*cell == 1);
+  if (board->ages && *cell != state)
+    *getBoardAge(board, x, y) = 0;
+  *cell = state;
+  markBoardTileChanged(board, x, y);
+  board->hash ^= getWordKey(wordIndex, loadCellWord(row, wordX, board->width));
+
+  BoardStats *stats = &board->stats;
+  stats->births = stats->deaths = 0;
+  if (state == 1 && stats->left < 0) {
+    stats->left = stats->right = x;
+    stats->top = stats->bottom = y;
+  } else if (state == 1) {
+    stats->left = x < stats->left ? x : stats->left;
+    stats->right = x > stats->right ? x : stats->right;
+    stats->top = y < stats->top ? y : stats->top;
+    stats->bottom = y > stats->bottom ? y : stats->bottom;
+  }
+}
+
+// Writes `count` cells of row y from x on, like setBoardCell would one by one
+// but a word at a time: only the words under the run are rehashed.
+void setBoardRow(Board *board, int x, int y, const uint8_t *states,
+                 int count);
+
+// Recomputes the hash and stats, and marks every tile changed. Call after
+// writing cells other than with setBoardCell; stepping keeps them up to date
+// by itself. Ages can't be told from such writes, so every cell is settled.
+void rehashBoard(Board *board);
+
+// Starts keeping the age of every cell, all of them settled to begin with.
+bool trackBoardAges(Board *board);
+
+// Sets every cell to dead and settled, and restarts the generation count.
+void clearBoard(Board *board);
+
+// Advances the board one generation.
+void stepBoard(Board *board);
+
+#endif // GOL_BOARD_H
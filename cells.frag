@@ -0,0 +1,49 @@
+#version 450
+
+// Expands the cells in view, uploaded 32 to a texel, into squares with a gap
+// in between each. Zoomed out past a pixel per cell a level of the density
+// pyramid is uploaded instead, and shaded from the dead to the live color.
+// Bindings follow SDL's SPIR-V layout: set 2 for the fragment samplers and
+// set 3 for its uniform buffers.
+
+layout(set = 2, binding = 0) uniform usampler2D cells;
+layout(set = 2, binding = 1) uniform sampler2D density;
+
+// Matches GpuUniforms in gpu.c
+layout(set = 3, binding = 0) uniform View {
+  vec2 origin; // Window position of the region's top left cell
+  float cellSize;
+  float gap;
+  ivec2 size; // Of the region, in cells or texels
+  int isDensity;
+  float scale; // Swapchain pixels per window pixel
+  vec4 background;
+  vec4 dead;
+  vec4 alive;
+};
+
+layout(location = 0) out vec4 color;
+
+void main() {
+  vec2 position = (gl_FragCoord.xy / scale - origin) / cellSize;
+  ivec2 cell = ivec2(floor(position));
+  if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, size))) {
+    color = background;
+    return;
+  }
+  if (isDensity != 0) {
+    color = mix(dead, alive, texelFetch(density, cell, 0).r);
+    return;
+  }
+
+  // The gap is split between both sides of the cell, as on the CPU.
+  vec2 within = (position - vec2(cell)) * cellSize;
+  vec2 margin = vec2(gap / 2.0);
+  if (gap > 0.0 && (any(lessThan(within, margin)) ||
+                    any(greaterThanEqual(within, cellSize - margin)))) {
+    color = background;
+    return;
+  }
+  uint word = texelFetch(cells, ivec2(cell.x >> 5, cell.y), 0).r;
+  color = ((word >> (cell.x & 31)) & 1u) != 0u ? alive : dead;
+}
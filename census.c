@@ -0,0 +1,535 @@
+#include "census.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ISOLATION_MIN_SIZE 32 // Side of the smallest isolation board
+#define OBJECT_MARGIN 4       // Dead cells around objects run in isolation
+#define SHIP_MARGIN 16        // Room for ships to move in isolation
+#define SHIP_MAX_PERIOD 32
+#define SHIP_MAX_POPULATION 64
+#define SHIP_CLEARANCE 8 // Distance from a ship to any other cell
+#define NAME_MAX (CENSUS_CODE_MAX + 16)
+
+static const char codeDigits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+// FNV-1a
+static uint64_t hashCode(const char *code) {
+  uint64_t hash = 0xCBF29CE484222325u;
+  for (; *code; code++)
+    hash = (hash ^ (uint8_t)*code) * 0x100000001B3u;
+  return hash;
+}
+
+static bool growCensus(Census *census) {
+  size_t capacity = census->capacity ? census->capacity * 2 : 64;
+  CensusEntry *entries = calloc(capacity, sizeof(CensusEntry));
+  if (!entries)
+    return false;
+
+  for (size_t i = 0; i < census->capacity; i++) {
+    const CensusEntry *entry = &census->entries[i];
+    if (!entry->code)
+      continue;
+    size_t slot = hashCode(entry->code) & (capacity - 1);
+    while (entries[slot].code)
+      slot = (slot + 1) & (capacity - 1);
+    entries[slot] = *entry;
+  }
+  free(census->entries);
+  census->entries = entries;
+  census->capacity = capacity;
+  return true;
+}
+
+bool countCensusObject(Census *census, const char *code, uint64_t count) {
+  // The table is kept at most half full.
+  if (2 * (census->count + 1) > census->capacity && !growCensus(census))
+    return false;
+
+  size_t mask = census->capacity - 1;
+  size_t slot = hashCode(code) & mask;
+  for (; census->entries[slot].code; slot = (slot + 1) & mask) {
+    if (strcmp(census->entries[slot].code, code) == 0) {
+      census->entries[slot].count += count;
+      return true;
+    }
+  }
+
+  size_t size = strlen(code) + 1;
+  char *copy = malloc(size);
+  if (!copy)
+    return false;
+  memcpy(copy, code, size);
+  census->entries[slot] = (CensusEntry){.code = copy, .count = count};
+  census->count++;
+  return true;
+}
+
+bool mergeCensus(Census *census, const Census *other) {
+  for (size_t i = 0; i < other->capacity; i++) {
+    const CensusEntry *entry = &other->entries[i];
+    if (entry->code && !countCensusObject(census, entry->code, entry->count))
+      return false;
+  }
+  return true;
+}
+
+void freeCensus(Census *census) {
+  for (size_t i = 0; i < census->capacity; i++)
+    free(census->entries[i].code);
+  free(census->entries);
+  *census = (Census){0};
+}
+
+static int compareEntries(const void *a, const void *b) {
+  const CensusEntry *first = a, *second = b;
+  if (first->count != second->count)
+    return first->count > second->count ? -1 : 1;
+  return strcmp(first->code, second->code);
+}
+
+CensusEntry *sortCensus(const Census *census) {
+  CensusEntry *list = malloc((census->count ? census->count : 1) *
+                             sizeof(CensusEntry));
+  if (!list)
+    return nullptr;
+
+  size_t count = 0;
+  for (size_t i = 0; i < census->capacity; i++) {
+    if (census->entries[i].code)
+      list[count++] = census->entries[i];
+  }
+  qsort(list, count, sizeof(CensusEntry), compareEntries);
+  return list;
+}
+
+bool initObjectSeparator(ObjectSeparator *separator, int width, int height,
+                         const Rule *rule) {
+  size_t cellCount = (size_t)width * height;
+  *separator = (ObjectSeparator){
+      .width = width,
+      .height = height,
+      .rule = *rule,
+      .mask = malloc(cellCount),
+      .labels = malloc(cellCount * sizeof(int32_t)),
+      .cells = malloc(cellCount * sizeof(int32_t)),
+      .starts = malloc((cellCount + 1) * sizeof(int32_t)),
+      .failed = malloc(cellCount * sizeof(int32_t)),
+      .firstPhase = malloc(cellCount),
+  };
+  if (!separator->mask || !separator->labels || !separator->cells ||
+      !separator->starts || !separator->failed || !separator->firstPhase) {
+    freeObjectSeparator(separator);
+    return false;
+  }
+  return true;
+}
+
+void freeObjectSeparator(ObjectSeparator *separator) {
+  free(separator->mask);
+  free(separator->labels);
+  free(separator->cells);
+  free(separator->starts);
+  free(separator->failed);
+  free(separator->firstPhase);
+  for (int i = 0; i < CENSUS_SIZE_CLASSES; i++) {
+    if (separator->isolation[i].cells)
+      freeBoard(&separator->isolation[i]);
+  }
+  *separator = (ObjectSeparator){0};
+}
+
+// Groups the masked cells into objects, whose cells are within `radius` of
+// each other, counting diagonal steps as one. Returns the number of objects.
+static int labelObjects(ObjectSeparator *separator, int radius) {
+  int width = separator->width, height = separator->height;
+  size_t cellCount = (size_t)width * height;
+  int32_t *labels = separator->labels, *cells = separator->cells;
+  memset(labels, 0xFF, cellCount * sizeof(int32_t));
+
+  // Each object's cells double as the queue of its flood fill.
+  int objectCount = 0;
+  int32_t end = 0;
+  for (size_t i = 0; i < cellCount; i++) {
+    if (!separator->mask[i] || labels[i] >= 0)
+      continue;
+
+    separator->starts[objectCount] = end;
+    labels[i] = objectCount;
+    cells[end++] = (int32_t)i;
+    for (int32_t next = separator->starts[objectCount]; next < end; next++) {
+      int x = cells[next] % width, y = cells[next] / width;
+      for (int ny = y - radius; ny <= y + radius; ny++) {
+        if (ny < 0 || ny >= height)
+          continue;
+        for (int nx = x - radius; nx <= x + radius; nx++) {
+          int32_t j = ny * width + nx;
+          if (nx >= 0 && nx < width && separator->mask[j] && labels[j] < 0) {
+            labels[j] = objectCount;
+            cells[end++] = j;
+          }
+        }
+      }
+    }
+    objectCount++;
+  }
+  separator->starts[objectCount] = end;
+  return objectCount;
+}
+
+typedef struct {
+  int left, top, width, height;
+  int population;
+} Bounds;
+
+static Bounds getCellBounds(const ObjectSeparator *separator,
+                            const int32_t *cells, int count) {
+  int left = separator->width, top = separator->height, right = -1;
+  int bottom = -1;
+  for (int i = 0; i < count; i++) {
+    int x = cells[i] % separator->width, y = cells[i] / separator->width;
+    left = x < left ? x : left;
+    right = x > right ? x : right;
+    top = y < top ? y : top;
+    bottom = y > bottom ? y : bottom;
+  }
+  return (Bounds){left, top, right - left + 1, bottom - top + 1, count};
+}
+
+static Bounds getBoardBounds(const Board *board) {
+  int left = board->width, top = board->height, right = -1, bottom = -1;
+  int population = 0;
+  for (int y = 0; y < board->height; y++) {
+    const uint8_t *row = getBoardCell(board, 0, y);
+    for (int x = 0; x < board->width; x++) {
+      if (!row[x])
+        continue;
+      population++;
+      left = x < left ? x : left;
+      right = x > right ? x : right;
+      top = y < top ? y : top;
+      bottom = y > bottom ? y : bottom;
+    }
+  }
+  if (!population)
+    return (Bounds){0};
+  return (Bounds){left, top, right - left + 1, bottom - top + 1, population};
+}
+
+// Returns an isolation board at least `size` cells a side, or nullptr.
+static Board *getIsolationBoard(ObjectSeparator *separator, int size) {
+  int classSize = ISOLATION_MIN_SIZE;
+  for (int i = 0; i < CENSUS_SIZE_CLASSES; i++, classSize *= 2) {
+    if (classSize < size)
+      continue;
+    Board *board = &separator->isolation[i];
+    if (!board->cells &&
+        !initBoard(board, classSize, classSize, &separator->rule))
+      return nullptr;
+    return board;
+  }
+  return nullptr;
+}
+
+// Copies the live ones of the listed cells onto an isolation board, with at
+// least `margin` dead cells around the bounds of all of them.
+static Board *isolateCells(ObjectSeparator *separator, const Board *board,
+                           const int32_t *cells, int count, int margin) {
+  Bounds bounds = getCellBounds(separator, cells, count);
+  int size = bounds.width > bounds.height ? bounds.width : bounds.height;
+  Board *isolation = getIsolationBoard(separator, size + 2 * margin);
+  if (!isolation)
+    return nullptr;
+
+  for (int i = 0; i < count; i++) {
+    int x = cells[i] % separator->width, y = cells[i] / separator->width;
+    uint8_t state = *getBoardCell(board, x, y);
+    if (state)
+      setBoardCell(isolation, x - bounds.left + margin,
+                   y - bounds.top + margin, state);
+  }
+  return isolation;
+}
+
+// Whether a cell is alive in the bounds seen in one of 8 orientations: bit 0
+// mirrors columns, bit 1 mirrors rows and bit 2 swaps rows and columns.
+static inline int isOrientedCellAlive(const Board *board, Bounds bounds,
+                                      int orientation, int x, int y) {
+  int sourceX = orientation & 4 ? y : x, sourceY = orientation & 4 ? x : y;
+  if (orientation & 1)
+    sourceX = bounds.width - 1 - sourceX;
+  if (orientation & 2)
+    sourceY = bounds.height - 1 - sourceY;
+  return *getBoardCell(board, bounds.left + sourceX, bounds.top + sourceY) !=
+         0;
+}
+
+// Runs of zeros are written as w for 2, x for 3, and y and a digit for 4 to
+// 39.
+static size_t writeZeros(char *code, size_t length, int zeros) {
+  while (zeros > 0) {
+    if (zeros == 1) {
+      code[length++] = '0';
+      zeros = 0;
+    } else if (zeros == 2) {
+      code[length++] = 'w';
+      zeros = 0;
+    } else if (zeros == 3) {
+      code[length++] = 'x';
+      zeros = 0;
+    } else {
+      int run = zeros < 39 ? zeros : 39;
+      code[length++] = 'y';
+      code[length++] = codeDigits[run - 4];
+      zeros -= run;
+    }
+  }
+  return length;
+}
+
+// Writes the extended Wechsler code of the bounds in one orientation: strips
+// of 5 rows separated by z, each a digit per column of 5 cells with the top
+// cell in bit 0, without trailing zeros. Returns the length, or 0 when it
+// doesn't fit.
+static size_t encodeWechsler(const Board *board, Bounds bounds,
+                             int orientation, char *code) {
+  bool isTransposed = orientation & 4;
+  int width = isTransposed ? bounds.height : bounds.width;
+  int height = isTransposed ? bounds.width : bounds.height;
+  size_t length = 0;
+  for (int top = 0; top < height; top += 5) {
+    if (top > 0) {
+      if (length + 1 >= CENSUS_CODE_MAX)
+        return 0;
+      code[length++] = 'z';
+    }
+
+    int zeros = 0;
+    for (int x = 0; x < width; x++) {
+      int column = 0;
+      for (int bit = 0; bit < 5 && top + bit < height; bit++)
+        column |= isOrientedCellAlive(board, bounds, orientation, x,
+                                      top + bit)
+                  << bit;
+      if (!column) {
+        zeros++;
+        continue;
+      }
+
+      // Zeros take at most two characters per 39.
+      if (length + 2 * (zeros / 39 + 1) + 1 >= CENSUS_CODE_MAX)
+        return 0;
+      length = writeZeros(code, length, zeros);
+      zeros = 0;
+      code[length++] = codeDigits[column];
+    }
+  }
+  code[length] = '\0';
+  return length;
+}
+
+// Keeps the best code of the bounds over all orientations: the shortest, and
+// of those the first in order.
+static void updateBestCode(const Board *board, Bounds bounds, char *best,
+                           size_t *bestLength) {
+  char code[CENSUS_CODE_MAX];
+  for (int orientation = 0; orientation < 8; orientation++) {
+    size_t length = encodeWechsler(board, bounds, orientation, code);
+    if (length && (!*bestLength || length < *bestLength ||
+                   (length == *bestLength && strcmp(code, best) < 0))) {
+      memcpy(best, code, length + 1);
+      *bestLength = length;
+    }
+  }
+}
+
+// How an object behaves on its own.
+typedef struct {
+  int period;     // Generations until it repeats, 0 if it didn't
+  int dx, dy;     // Distance moved per period
+  int population; // Of its first phase
+  char code[CENSUS_CODE_MAX];
+} ObjectClass;
+
+static bool isSameShape(const Board *board, Bounds bounds,
+                        const uint8_t *shape, Bounds shapeBounds) {
+  if (bounds.population != shapeBounds.population ||
+      bounds.width != shapeBounds.width || bounds.height != shapeBounds.height)
+    return false;
+  for (int y = 0; y < bounds.height; y++) {
+    if (memcmp(getBoardCell(board, bounds.left, bounds.top + y),
+               shape + y * bounds.width, bounds.width) != 0)
+      return false;
+  }
+  return true;
+}
+
+// Steps an isolation board until its cells repeat their first phase in shape,
+// for at most `maxPeriod` generations, and clears it afterwards.
+static void runIsolated(ObjectSeparator *separator, Board *board,
+                        int maxPeriod, ObjectClass *object) {
+  Bounds first = getBoardBounds(board);
+  *object = (ObjectClass){.population = first.population};
+  for (int y = 0; y < first.height; y++)
+    memcpy(separator->firstPhase + y * first.width,
+           getBoardCell(board, first.left, first.top + y), first.width);
+
+  size_t codeLength = 0;
+  Bounds bounds = first;
+  for (int generation = 1; first.population && generation <= maxPeriod;
+       generation++) {
+    updateBestCode(board, bounds, object->code, &codeLength);
+    stepBoard(board);
+    bounds = getBoardBounds(board);
+
+    // Cells that die out or reach the wrapping edge aren't an object.
+    if (!bounds.population || bounds.left == 0 || bounds.top == 0 ||
+        bounds.left + bounds.width == board->width ||
+        bounds.top + bounds.height == board->height)
+      break;
+    if (isSameShape(board, bounds, separator->firstPhase, first)) {
+      object->period = generation;
+      object->dx = bounds.left - first.left;
+      object->dy = bounds.top - first.top;
+      break;
+    }
+  }
+  if (!codeLength)
+    object->period = 0;
+  clearBoard(board);
+}
+
+static void nameObject(const ObjectClass *object, char *name) {
+  if (object->dx || object->dy)
+    snprintf(name, NAME_MAX, "xq%d_%s", object->period, object->code);
+  else if (object->period > 1)
+    snprintf(name, NAME_MAX, "xp%d_%s", object->period, object->code);
+  else
+    snprintf(name, NAME_MAX, "xs%d_%s", object->population, object->code);
+}
+
+// Classifies the objects of the current labels, which must keep still over
+// the board's period. Cells of objects that don't are added to the failed
+// list, or without one counted as PATHOLOGICAL. Returns false when out of
+// memory.
+static bool countObjects(ObjectSeparator *separator, const Board *board,
+                         int objectCount, int period, Census *census,
+                         int32_t *failedCount) {
+  for (int i = 0; i < objectCount; i++) {
+    const int32_t *cells = separator->cells + separator->starts[i];
+    int count = separator->starts[i + 1] - separator->starts[i];
+    Board *isolation =
+        isolateCells(separator, board, cells, count, OBJECT_MARGIN);
+    if (!isolation)
+      return false;
+
+    ObjectClass object;
+    runIsolated(separator, isolation, period, &object);
+    if (object.period && period % object.period == 0 && !object.dx &&
+        !object.dy) {
+      char name[NAME_MAX];
+      nameObject(&object, name);
+      if (!countCensusObject(census, name, 1))
+        return false;
+    } else if (failedCount) {
+      memcpy(separator->failed + *failedCount, cells,
+             count * sizeof(int32_t));
+      *failedCount += count;
+    } else if (!countCensusObject(census, "PATHOLOGICAL", 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool censusBoard(ObjectSeparator *separator, Board *board, int period,
+                 Census *census) {
+  // Objects are told apart by the cells they cover over a whole period.
+  int width = separator->width;
+  memset(separator->mask, 0, (size_t)width * separator->height);
+  for (int phase = 0; phase < period; phase++) {
+    for (int y = 0; y < separator->height; y++) {
+      const uint8_t *row = getBoardCell(board, 0, y);
+      for (int x = 0; x < width; x++)
+        separator->mask[y * width + x] |= row[x] != 0;
+    }
+    stepBoard(board);
+  }
+
+  int32_t failedCount = 0;
+  int objectCount = labelObjects(separator, 1);
+  if (!countObjects(separator, board, objectCount, period, census,
+                    &failedCount))
+    return false;
+  if (!failedCount)
+    return true;
+
+  // Objects that only keep still next to each other get another chance as
+  // one, grouped more loosely, before they are given up on.
+  memset(separator->mask, 0, (size_t)width * separator->height);
+  for (int32_t i = 0; i < failedCount; i++)
+    separator->mask[separator->failed[i]] = 1;
+  objectCount = labelObjects(separator, 2);
+  return countObjects(separator, board, objectCount, period, census, nullptr);
+}
+
+// Whether no cell of another object is within the clearance of the bounds.
+static bool isClearOfOthers(const ObjectSeparator *separator, int object,
+                            Bounds bounds) {
+  int left = bounds.left - SHIP_CLEARANCE, top = bounds.top - SHIP_CLEARANCE;
+  int right = bounds.left + bounds.width + SHIP_CLEARANCE;
+  int bottom = bounds.top + bounds.height + SHIP_CLEARANCE;
+  left = left < 0 ? 0 : left;
+  top = top < 0 ? 0 : top;
+  right = right > separator->width ? separator->width : right;
+  bottom = bottom > separator->height ? separator->height : bottom;
+
+  for (int y = top; y < bottom; y++) {
+    for (int x = left; x < right; x++) {
+      int32_t label = separator->labels[y * separator->width + x];
+      if (label >= 0 && label != object)
+        return false;
+    }
+  }
+  return true;
+}
+
+int removeSpaceships(ObjectSeparator *separator, Board *board,
+                     Census *census) {
+  int width = separator->width;
+  for (int y = 0; y < separator->height; y++) {
+    const uint8_t *row = getBoardCell(board, 0, y);
+    for (int x = 0; x < width; x++)
+      separator->mask[y * width + x] = row[x] != 0;
+  }
+
+  int removed = 0;
+  int objectCount = labelObjects(separator, 2);
+  for (int i = 0; i < objectCount; i++) {
+    const int32_t *cells = separator->cells + separator->starts[i];
+    int count = separator->starts[i + 1] - separator->starts[i];
+    if (count > SHIP_MAX_POPULATION ||
+        !isClearOfOthers(separator, i, getCellBounds(separator, cells, count)))
+      continue;
+
+    Board *isolation =
+        isolateCells(separator, board, cells, count, SHIP_MARGIN);
+    if (!isolation)
+      return -1;
+    ObjectClass object;
+    runIsolated(separator, isolation, SHIP_MAX_PERIOD, &object);
+    if (!object.period || (!object.dx && !object.dy))
+      continue;
+
+    char name[NAME_MAX];
+    nameObject(&object, name);
+    if (!countCensusObject(census, name, 1))
+      return -1;
+    for (int j = 0; j < count; j++)
+      setBoardCell(board, cells[j] % width, cells[j] / width, 0);
+    removed++;
+  }
+  return removed;
+}
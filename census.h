@@ -0,0 +1,75 @@
+#ifndef GOL_CENSUS_H
+#define GOL_CENSUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+
+#define CENSUS_CODE_MAX 1024  // Longest object code, terminator included
+#define CENSUS_SIZE_CLASSES 8 // Sizes of isolation boards, doubling from 32
+
+// Counts of objects by code, in an open addressing hash table.
+typedef struct {
+  char *code;
+  uint64_t count;
+} CensusEntry;
+
+typedef struct {
+  CensusEntry *entries; // Empty slots have no code
+  size_t count, capacity;
+} Census;
+
+// Adds `count` objects of a code. Returns false when out of memory.
+bool countCensusObject(Census *census, const char *code, uint64_t count);
+
+// Adds the counts of another census.
+bool mergeCensus(Census *census, const Census *other);
+
+void freeCensus(Census *census);
+
+// Lists the entries by descending count, then by code. The list points into
+// the census and is freed with free(). Returns nullptr when out of memory.
+CensusEntry *sortCensus(const Census *census);
+
+// Splits boards of one size into objects and tells them apart. Objects are
+// named by apgcode, as Catagolue does: "xs" still lifes, "xp" oscillators and
+// "xq" spaceships, followed by the population or period and the extended
+// Wechsler code of the phase and orientation with the shortest, then first,
+// code. Objects that don't behave on their own like on the board are
+// "PATHOLOGICAL".
+//
+// Only two-state rules of the 8 neighbor Moore neighborhood are supported,
+// and the board is treated as a plane, so objects are assumed to stay clear
+// of its edges.
+typedef struct {
+  int width, height;
+  Rule rule;
+
+  uint8_t *mask;       // Cells to split into objects
+  int32_t *labels;     // Object of each masked cell, -1 while unlabeled
+  int32_t *cells;      // Cells of each object, one after another
+  int32_t *starts;     // Index into `cells` of each object, and the end
+  int32_t *failed;     // Cells of objects that need another look
+  uint8_t *firstPhase; // Object cells at the start of a run in isolation
+
+  Board isolation[CENSUS_SIZE_CLASSES]; // Allocated on first use
+} ObjectSeparator;
+
+bool initObjectSeparator(ObjectSeparator *separator, int width, int height,
+                         const Rule *rule);
+void freeObjectSeparator(ObjectSeparator *separator);
+
+// Counts the objects of a board that repeats every `period` generations. The
+// board is stepped through one period, which leaves it as it was.
+bool censusBoard(ObjectSeparator *separator, Board *board, int period,
+                 Census *census);
+
+// Takes spaceships that are well clear of every other cell off the board and
+// counts them, so that escaping ships don't keep the board from settling.
+// Returns the number of ships taken, or -1 when out of memory.
+int removeSpaceships(ObjectSeparator *separator, Board *board,
+                     Census *census);
+
+#endif // GOL_CENSUS_H
@@ -0,0 +1,105 @@
+#include "checkpoint.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+#include "trace.h"
+
+void startCheckpointer(Checkpointer *checkpointer, const char *path,
+                       uint64_t everyGenerations, uint64_t everyMilliseconds,
+                       const Board *board) {
+  *checkpointer = (Checkpointer){
+      .path = path,
+      .everyGenerations = everyGenerations,
+      .everyMilliseconds = everyMilliseconds,
+      .isStarted = true,
+      .lastGeneration = board->generation,
+      .lastTicks = SDL_GetTicks(),
+  };
+}
+
+static void logCheckpoint(const Checkpointer *checkpointer, bool isWritten,
+                          uint64_t generation) {
+  if (isWritten)
+    SDL_Log("Checkpointed generation %llu to %s",
+            (unsigned long long)generation, checkpointer->path);
+  else
+    SDL_Log("Couldn't write checkpoint to %s", checkpointer->path);
+}
+
+// Reaps the child once it has exited, waiting for it if `shouldWait`.
+// Returns false while it is still writing.
+static bool reapWriter(Checkpointer *checkpointer, bool shouldWait) {
+  if (!checkpointer->writer)
+    return true;
+
+  int status;
+  pid_t pid;
+  do {
+    pid = waitpid(checkpointer->writer, &status, shouldWait ? 0 : WNOHANG);
+  } while (pid < 0 && errno == EINTR);
+  if (pid == 0)
+    return false;
+
+  logCheckpoint(checkpointer,
+                pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                checkpointer->writerGeneration);
+  checkpointer->writer = 0;
+  return true;
+}
+
+// Forks a child that writes the board and exits. The child only ever runs
+// writeSnapshot, which is safe to call from a fork of a threaded process.
+static void forkWriter(Checkpointer *checkpointer, const Board *board) {
+  pid_t pid;
+  WITH_TRACED_SPAN("fork checkpoint") {
+    pid = fork();
+    if (pid == 0)
+      _exit(writeSnapshot(checkpointer->path, board) ? 0 : 1);
+  }
+  if (pid < 0) {
+    SDL_Log("Couldn't fork a checkpoint writer: %s", strerror(errno));
+    return;
+  }
+  checkpointer->writer = pid;
+  checkpointer->writerGeneration = board->generation;
+  checkpointer->lastGeneration = board->generation;
+  checkpointer->lastTicks = SDL_GetTicks();
+}
+
+void updateCheckpointer(Checkpointer *checkpointer, const Board *board) {
+  if (!checkpointer->isStarted)
+    return;
+
+  // Rewinding the board restarts the generation count.
+  if (board->generation < checkpointer->lastGeneration)
+    checkpointer->lastGeneration = board->generation;
+
+  bool isDue = (checkpointer->everyGenerations &&
+                board->generation - checkpointer->lastGeneration >=
+                    checkpointer->everyGenerations) ||
+               (checkpointer->everyMilliseconds &&
+                SDL_GetTicks() - checkpointer->lastTicks >=
+                    checkpointer->everyMilliseconds);
+
+  // A checkpoint that finds the child still writing is taken on a later step
+  // instead.
+  if (reapWriter(checkpointer, false) && isDue)
+    forkWriter(checkpointer, board);
+}
+
+void stopCheckpointer(Checkpointer *checkpointer, const Board *board) {
+  if (!checkpointer->isStarted)
+    return;
+
+  reapWriter(checkpointer, true);
+  bool isWritten;
+  WITH_TRACED_SPAN("write checkpoint") {
+    isWritten = writeSnapshot(checkpointer->path, board);
+  }
+  logCheckpoint(checkpointer, isWritten, board->generation);
+  *checkpointer = (Checkpointer){0};
+}
@@ -0,0 +1,41 @@
+#ifndef GOL_CHECKPOINT_H
+#define GOL_CHECKPOINT_H
+
+#include <sys/types.h>
+
+#include <SDL3/SDL.h>
+
+#include "board.h"
+
+// Writes snapshots of the board every N generations or T seconds from a
+// forked child. The child sees the board as it was at the fork through
+// copy-on-write pages, so nothing is copied up front: the kernel copies only
+// the pages the app writes to while the child is still writing. While the
+// previous checkpoint is still being written, the next one waits for a later
+// step.
+typedef struct {
+  const char *path;
+  uint64_t everyGenerations;  // 0 to not checkpoint by generation
+  uint64_t everyMilliseconds; // 0 to not checkpoint by time
+  bool isStarted;
+
+  pid_t writer;              // Child writing a checkpoint, or 0
+  uint64_t writerGeneration; // Generation the child writes
+
+  uint64_t lastGeneration; // Generation of the last checkpoint taken
+  uint64_t lastTicks;      // Time of the last checkpoint taken
+} Checkpointer;
+
+void startCheckpointer(Checkpointer *checkpointer, const char *path,
+                       uint64_t everyGenerations, uint64_t everyMilliseconds,
+                       const Board *board);
+
+// Forks a child to write the board if a checkpoint is due and no other child
+// is writing, and logs how the last child did once it exits. Call after
+// every step.
+void updateCheckpointer(Checkpointer *checkpointer, const Board *board);
+
+// Waits for the checkpoint in progress and writes a final one of the board.
+void stopCheckpointer(Checkpointer *checkpointer, const Board *board);
+
+#endif // GOL_CHECKPOINT_H
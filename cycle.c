@@ -0,0 +1,28 @@
+#include "cycle.h"
+
+void clearCycleDetector(CycleDetector *detector) {
+  detector->count = 0;
+  detector->period = 0;
+}
+
+int updateCycleDetector(CycleDetector *detector, const Board *board) {
+  uint64_t generation = board->generation;
+  if (detector->count > 0 && generation != detector->lastGeneration + 1)
+    clearCycleDetector(detector);
+
+  // The newest generations are checked first, so the smallest period wins.
+  detector->period = 0;
+  for (int period = 1; period <= detector->count; period++) {
+    if (detector->hashes[(generation - period) % CYCLE_MAX_PERIOD] ==
+        board->hash) {
+      detector->period = period;
+      break;
+    }
+  }
+
+  detector->hashes[generation % CYCLE_MAX_PERIOD] = board->hash;
+  detector->lastGeneration = generation;
+  if (detector->count < CYCLE_MAX_PERIOD)
+    detector->count++;
+  return detector->period;
+}
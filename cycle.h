@@ -0,0 +1,29 @@
+#ifndef GOL_CYCLE_H
+#define GOL_CYCLE_H
+
+#include <stdint.h>
+
+#include "board.h"
+
+#define CYCLE_MAX_PERIOD 256 // Longest period detected
+
+// Hashes of a board's recent generations, for telling when it settles into a
+// still life or an oscillator. The board equals an earlier generation when
+// their hashes match, so no boards are kept or compared.
+typedef struct {
+  uint64_t hashes[CYCLE_MAX_PERIOD]; // Indexed by generation, wrapping
+  uint64_t lastGeneration;           // Generation of the newest hash
+  int count;                         // Consecutive generations kept
+  int period;                        // Period at the newest generation
+} CycleDetector;
+
+// Forgets the recorded generations, e.g. after the board was edited.
+void clearCycleDetector(CycleDetector *detector);
+
+// Records the board's current generation. Returns the smallest period P for
+// which the board equals its generation P steps ago, which is 1 for still
+// lifes and empty boards, or 0 when it hasn't repeated within the generations
+// kept. Call after every step; non-consecutive generations start over.
+int updateCycleDetector(CycleDetector *detector, const Board *board);
+
+#endif // GOL_CYCLE_H
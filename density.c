@@ -0,0 +1,121 @@
+#include "density.h"
+
+#include <stdlib.h>
+
+// A tile is a single texel at this level.
+#define TILE_LEVEL 6
+#if (1 << TILE_LEVEL) != BOARD_TILE_SIZE
+#error "BOARD_TILE_SIZE must be 2^TILE_LEVEL"
+#endif
+
+bool initDensityPyramid(DensityPyramid *pyramid, int width, int height) {
+  *pyramid = (DensityPyramid){.isStale = true};
+  int level = 0;
+  pyramid->widths[0] = width;
+  pyramid->heights[0] = height;
+  while ((width > 1 || height > 1) && level + 1 < DENSITY_MAX_LEVELS) {
+    level++;
+    width = (width + 1) / 2;
+    height = (height + 1) / 2;
+    pyramid->widths[level] = width;
+    pyramid->heights[level] = height;
+    pyramid->levels[level] = malloc((size_t)width * height);
+    if (!pyramid->levels[level]) {
+      freeDensityPyramid(pyramid);
+      return false;
+    }
+  }
+  pyramid->levelCount = level + 1;
+  return true;
+}
+
+void freeDensityPyramid(DensityPyramid *pyramid) {
+  for (int level = 0; level < DENSITY_MAX_LEVELS; level++)
+    free(pyramid->levels[level]);
+  *pyramid = (DensityPyramid){0};
+}
+
+// Counts the live cells of 2x2 blocks into texels [x0, x1) x [y0, y1) of
+// level 1. Blocks hanging over the board's edge are short of cells, which
+// count as dead, rather than reading the wrapped ghost border.
+static void downsampleCells(DensityPyramid *pyramid, const Board *board,
+                            int x0, int y0, int x1, int y1) {
+  int width = board->width, height = board->height;
+  uint8_t *texels = pyramid->levels[1];
+  for (int y = y0; y < y1; y++) {
+    const uint8_t *top = getBoardCell(board, 0, 2 * y);
+    const uint8_t *bottom = top + board->stride;
+    bool hasBottom = 2 * y + 1 < height;
+    uint8_t *row = &texels[(size_t)y * pyramid->widths[1]];
+    for (int x = x0; x < x1; x++) {
+      int cellX = 2 * x;
+      int live = (top[cellX] == 1) + (hasBottom && bottom[cellX] == 1);
+      if (cellX + 1 < width)
+        live += (top[cellX + 1] == 1) + (hasBottom && bottom[cellX + 1] == 1);
+      row[x] = (uint8_t)(live * 255 / 4);
+    }
+  }
+}
+
+// Averages 2x2 texels of the level below into texels [x0, x1) x [y0, y1).
+static void downsampleLevel(DensityPyramid *pyramid, int level, int x0,
+                            int y0, int x1, int y1) {
+  const uint8_t *source = pyramid->levels[level - 1];
+  int sourceWidth = pyramid->widths[level - 1];
+  int sourceHeight = pyramid->heights[level - 1];
+  uint8_t *texels = pyramid->levels[level];
+  for (int y = y0; y < y1; y++) {
+    const uint8_t *top = &source[(size_t)2 * y * sourceWidth];
+    const uint8_t *bottom = top + sourceWidth;
+    bool hasBottom = 2 * y + 1 < sourceHeight;
+    uint8_t *row = &texels[(size_t)y * pyramid->widths[level]];
+    for (int x = x0; x < x1; x++) {
+      int sourceX = 2 * x;
+      int sum = top[sourceX] + (hasBottom ? bottom[sourceX] : 0);
+      if (sourceX + 1 < sourceWidth)
+        sum += top[sourceX + 1] + (hasBottom ? bottom[sourceX + 1] : 0);
+      row[x] = (uint8_t)((sum + 2) / 4);
+    }
+  }
+}
+
+static int minInt(int a, int b) {
+  return a < b ? a : b;
+}
+
+void updateDensityPyramid(DensityPyramid *pyramid, Board *board) {
+  bool hasChanges = false;
+  for (int tileY = 0; tileY < board->tileRows; tileY++) {
+    for (int tileX = 0; tileX < board->tileColumns; tileX++) {
+      uint8_t *changed =
+          &board->changedTiles[tileY * board->tileColumns + tileX];
+      if (!*changed && !pyramid->isStale)
+        continue;
+      *changed = 0;
+      hasChanges = true;
+
+      // The tile's texels on each level up to the one where it is a texel,
+      // each level read from the one below.
+      for (int level = 1; level < pyramid->levelCount && level <= TILE_LEVEL;
+           level++) {
+        int side = 1 << (TILE_LEVEL - level);
+        int x0 = tileX * side, y0 = tileY * side;
+        int x1 = minInt(x0 + side, pyramid->widths[level]);
+        int y1 = minInt(y0 + side, pyramid->heights[level]);
+        if (level == 1)
+          downsampleCells(pyramid, board, x0, y0, x1, y1);
+        else
+          downsampleLevel(pyramid, level, x0, y0, x1, y1);
+      }
+    }
+  }
+
+  // Levels coarser than a tile have a texel per 4096 or more cells, so they
+  // are cheap enough to redo whole.
+  if (hasChanges) {
+    for (int level = TILE_LEVEL + 1; level < pyramid->levelCount; level++)
+      downsampleLevel(pyramid, level, 0, 0, pyramid->widths[level],
+                      pyramid->heights[level]);
+  }
+  pyramid->isStale = false;
+}
@@ -0,0 +1,35 @@
+#ifndef GOL_DENSITY_H
+#define GOL_DENSITY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "board.h"
+
+#define DENSITY_MAX_LEVELS 32
+
+// Downsampled copies of a board for drawing it zoomed out, like the mip maps
+// of a texture. Level k has a texel per 2^k x 2^k block of cells, holding the
+// share of them that are live from 0 to 255, each level averaging the one
+// below. Level 0 would be the board itself and isn't stored. The levels are
+// brought up to date a tile of changed cells at a time.
+typedef struct {
+  int levelCount; // Including level 0, up to the first 1x1 level
+  int widths[DENSITY_MAX_LEVELS], heights[DENSITY_MAX_LEVELS];
+  uint8_t *levels[DENSITY_MAX_LEVELS]; // Row-major texels of each level
+  bool isStale; // Not built yet, so every tile needs doing
+} DensityPyramid;
+
+bool initDensityPyramid(DensityPyramid *pyramid, int width, int height);
+void freeDensityPyramid(DensityPyramid *pyramid);
+
+// Redoes the texels over the tiles the board marked changed, and clears the
+// marks.
+void updateDensityPyramid(DensityPyramid *pyramid, Board *board);
+
+static inline uint8_t getDensity(const DensityPyramid *pyramid, int level,
+                                 int x, int y) {
+  return pyramid->levels[level][(size_t)y * pyramid->widths[level] + x];
+}
+
+#endif // GOL_DENSITY_H
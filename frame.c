@@ -0,0 +1,330 @@
+#include "frame.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PNG_MAX_DISTANCE 32768 // Farthest back a deflate match may reach
+#define PNG_MAX_MATCH 258      // Longest deflate match
+
+static size_t getPixelCount(const FrameStyle *style) {
+  return (size_t)style->width * style->scale * style->height * style->scale;
+}
+
+// Converts RGB to limited range BT.601 YCbCr.
+static void convertToYCbCr(const uint8_t rgb[3], uint8_t ycbcr[3]) {
+  int r = rgb[0], g = rgb[1], b = rgb[2];
+  ycbcr[0] = (uint8_t)(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+  ycbcr[1] = (uint8_t)(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+  ycbcr[2] = (uint8_t)(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+}
+
+bool initFrameEncoder(FrameEncoder *encoder, const FrameStyle *style,
+                      FrameFormat format) {
+  size_t pixelCount = getPixelCount(style);
+  size_t rowsSize = pixelCount + (size_t)style->height * style->scale;
+  *encoder = (FrameEncoder){
+      .style = *style,
+      .format = format,
+      .pixels = format == FRAME_PNG ? malloc(rowsSize) : nullptr,
+      // Unmatched deflate literals take at most 9 bits.
+      .out = malloc(format == FRAME_PNG ? rowsSize * 2 + 1024
+                                        : pixelCount * 3 + 64),
+  };
+  if (!encoder->out || (format == FRAME_PNG && !encoder->pixels)) {
+    freeFrameEncoder(encoder);
+    return false;
+  }
+
+  // States the rule lacks, which only unchecked snapshots hold, look alive.
+  for (int state = 0; state < RULE_MAX_STATES; state++) {
+    const uint8_t *color = style->palette[state < style->numStates ? state : 1];
+    if (format == FRAME_Y4M)
+      convertToYCbCr(color, encoder->colors[state]);
+    else
+      memcpy(encoder->colors[state], color, 3);
+  }
+  return true;
+}
+
+void freeFrameEncoder(FrameEncoder *encoder) {
+  free(encoder->pixels);
+  free(encoder->out);
+  *encoder = (FrameEncoder){0};
+}
+
+static size_t encodePpm(FrameEncoder *encoder, const uint8_t *cells) {
+  const FrameStyle *style = &encoder->style;
+  int scale = style->scale, pixelWidth = style->width * scale;
+  size_t rowSize = (size_t)pixelWidth * 3;
+  uint8_t *out = encoder->out;
+  out += sprintf((char *)out, "P6\n%d %d\n255\n", pixelWidth,
+                 style->height * scale);
+
+  for (int y = 0; y < style->height; y++) {
+    const uint8_t *row = cells + (size_t)y * style->width;
+    uint8_t *pixel = out;
+    for (int x = 0; x < style->width; x++) {
+      for (int i = 0; i < scale; i++, pixel += 3)
+        memcpy(pixel, encoder->colors[row[x]], 3);
+    }
+    for (int i = 1; i < scale; i++)
+      memcpy(out + i * rowSize, out, rowSize);
+    out += scale * rowSize;
+  }
+  return out - encoder->out;
+}
+
+// Y4M frames hold full resolution Y, Cb and Cr planes one after another.
+static size_t encodeY4m(FrameEncoder *encoder, const uint8_t *cells) {
+  const FrameStyle *style = &encoder->style;
+  int scale = style->scale, pixelWidth = style->width * scale;
+  size_t planeSize = getPixelCount(style);
+  uint8_t *out = encoder->out;
+  memcpy(out, "FRAME\n", 6);
+  out += 6;
+
+  for (int plane = 0; plane < 3; plane++) {
+    uint8_t *pixel = out + plane * planeSize;
+    for (int y = 0; y < style->height; y++) {
+      const uint8_t *row = cells + (size_t)y * style->width;
+      uint8_t *rowStart = pixel;
+      for (int x = 0; x < style->width; x++) {
+        memset(pixel, encoder->colors[row[x]][plane], scale);
+        pixel += scale;
+      }
+      for (int i = 1; i < scale; i++, pixel += pixelWidth)
+        memcpy(pixel, rowStart, pixelWidth);
+    }
+  }
+  return 6 + 3 * planeSize;
+}
+
+// Deflate streams are written least significant bit first.
+typedef struct {
+  uint8_t *out;
+  uint64_t bits;
+  int count;
+} BitWriter;
+
+static void writeBits(BitWriter *writer, uint32_t value, int count) {
+  writer->bits |= (uint64_t)value << writer->count;
+  writer->count += count;
+  for (; writer->count >= 8; writer->count -= 8) {
+    *writer->out++ = (uint8_t)writer->bits;
+    writer->bits >>= 8;
+  }
+}
+
+// Huffman codes are stored most significant bit first, unlike everything
+// else.
+static void writeCode(BitWriter *writer, uint32_t code, int length) {
+  uint32_t reversed = 0;
+  for (int i = 0; i < length; i++, code >>= 1)
+    reversed = (reversed << 1) | (code & 1);
+  writeBits(writer, reversed, length);
+}
+
+// Writes a literal/length symbol with the fixed Huffman code of deflate.
+static void writeSymbol(BitWriter *writer, int symbol) {
+  if (symbol < 144)
+    writeCode(writer, 0x30 + symbol, 8);
+  else if (symbol < 256)
+    writeCode(writer, 0x190 + symbol - 144, 9);
+  else if (symbol < 280)
+    writeCode(writer, symbol - 256, 7);
+  else
+    writeCode(writer, 0xC0 + symbol - 280, 8);
+}
+
+static const uint16_t lengthBases[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtraBits[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBases[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+static const uint8_t distanceExtraBits[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static void writeMatch(BitWriter *writer, int length, int distance) {
+  int code = 28;
+  while (lengthBases[code] > length)
+    code--;
+  writeSymbol(writer, 257 + code);
+  writeBits(writer, length - lengthBases[code], lengthExtraBits[code]);
+
+  code = 29;
+  while (distanceBases[code] > distance)
+    code--;
+  writeCode(writer, code, 5);
+  writeBits(writer, distance - distanceBases[code], distanceExtraBits[code]);
+}
+
+static int getMatchLength(const uint8_t *data, size_t position, size_t size,
+                          size_t distance) {
+  size_t limit = size - position;
+  if (limit > PNG_MAX_MATCH)
+    limit = PNG_MAX_MATCH;
+  size_t length = 0;
+  while (length < limit &&
+         data[position + length] == data[position + length - distance])
+    length++;
+  return (int)length;
+}
+
+// Compresses into a single fixed Huffman block. Board images are mostly runs
+// of one state and rows repeating the one above, so matches are only looked
+// for one byte and one row back.
+static uint8_t *deflate(const uint8_t *data, size_t size, size_t rowSize,
+                        uint8_t *out) {
+  BitWriter writer = {.out = out};
+  writeBits(&writer, 1, 1); // Final block
+  writeBits(&writer, 1, 2); // Fixed Huffman codes
+
+  size_t i = 0;
+  while (i < size) {
+    int length = 0, distance = 0;
+    if (i >= rowSize && rowSize <= PNG_MAX_DISTANCE) {
+      length = getMatchLength(data, i, size, rowSize);
+      distance = (int)rowSize;
+    }
+    if (i >= 1 && length < PNG_MAX_MATCH) {
+      int runLength = getMatchLength(data, i, size, 1);
+      if (runLength > length) {
+        length = runLength;
+        distance = 1;
+      }
+    }
+
+    if (length >= 3) {
+      writeMatch(&writer, length, distance);
+      i += length;
+    } else {
+      writeSymbol(&writer, data[i++]);
+    }
+  }
+  writeSymbol(&writer, 256); // End of block
+  writeBits(&writer, 0, 7);  // Flush the last byte
+  return writer.out;
+}
+
+static uint32_t updateCrc(uint32_t crc, const uint8_t *data, size_t size) {
+  static const uint32_t nibbleTable[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+      0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ nibbleTable[crc & 15];
+    crc = (crc >> 4) ^ nibbleTable[crc & 15];
+  }
+  return crc;
+}
+
+static uint32_t getAdler32(const uint8_t *data, size_t size) {
+  uint32_t a = 1, b = 0;
+  while (size > 0) {
+    // Sums can't overflow within 5552 bytes.
+    size_t count = size < 5552 ? size : 5552;
+    for (size_t i = 0; i < count; i++) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    size -= count;
+  }
+  return (b << 16) | a;
+}
+
+static uint8_t *writeBigEndian(uint8_t *out, uint32_t value) {
+  out[0] = (uint8_t)(value >> 24);
+  out[1] = (uint8_t)(value >> 16);
+  out[2] = (uint8_t)(value >> 8);
+  out[3] = (uint8_t)value;
+  return out + 4;
+}
+
+// Finishes a chunk whose type and data were written after `start`, which
+// leaves room for the length.
+static uint8_t *finishChunk(uint8_t *start, uint8_t *end) {
+  writeBigEndian(start, (uint32_t)(end - start - 8));
+  uint32_t crc = updateCrc(0xFFFFFFFF, start + 4, end - start - 4);
+  return writeBigEndian(end, crc ^ 0xFFFFFFFF);
+}
+
+static size_t encodePng(FrameEncoder *encoder, const uint8_t *cells) {
+  const FrameStyle *style = &encoder->style;
+  int scale = style->scale, pixelWidth = style->width * scale;
+  int pixelHeight = style->height * scale;
+  size_t rowSize = (size_t)pixelWidth + 1;
+
+  // Rows of state indices, unfiltered.
+  uint8_t *pixel = encoder->pixels;
+  for (int y = 0; y < style->height; y++) {
+    const uint8_t *row = cells + (size_t)y * style->width;
+    uint8_t *rowStart = pixel;
+    *pixel++ = 0;
+    for (int x = 0; x < style->width; x++) {
+      memset(pixel, row[x] < style->numStates ? row[x] : 1, scale);
+      pixel += scale;
+    }
+    for (int i = 1; i < scale; i++, pixel += rowSize)
+      memcpy(pixel, rowStart, rowSize);
+  }
+  size_t pixelsSize = pixel - encoder->pixels;
+
+  uint8_t *out = encoder->out, *chunk;
+  memcpy(out, "\x89PNG\r\n\x1A\n", 8);
+  out += 8;
+
+  chunk = out;
+  memcpy(out + 4, "IHDR", 4);
+  out = writeBigEndian(out + 8, pixelWidth);
+  out = writeBigEndian(out, pixelHeight);
+  memcpy(out, "\x08\x03\x00\x00\x00", 5); // 8-bit paletted, no interlace
+  out = finishChunk(chunk, out + 5);
+
+  chunk = out;
+  memcpy(out + 4, "PLTE", 4);
+  out += 8;
+  for (int state = 0; state < style->numStates; state++, out += 3)
+    memcpy(out, encoder->colors[state], 3);
+  out = finishChunk(chunk, out);
+
+  chunk = out;
+  memcpy(out + 4, "IDAT", 4);
+  out += 8;
+  *out++ = 0x78; // Deflate with a 32 KiB window
+  *out++ = 0x01;
+  out = deflate(encoder->pixels, pixelsSize, rowSize, out);
+  out = writeBigEndian(out, getAdler32(encoder->pixels, pixelsSize));
+  out = finishChunk(chunk, out);
+
+  chunk = out;
+  memcpy(out + 4, "IEND", 4);
+  out = finishChunk(chunk, out + 8);
+  return out - encoder->out;
+}
+
+size_t encodeFrame(FrameEncoder *encoder, const uint8_t *cells) {
+  switch (encoder->format) {
+  case FRAME_PPM:
+    return encodePpm(encoder, cells);
+  case FRAME_PNG:
+    return encodePng(encoder, cells);
+  case FRAME_Y4M:
+    return encodeY4m(encoder, cells);
+  }
+  return 0;
+}
+
+bool writeY4mHeader(FILE *file, const FrameStyle *style, int framesPerSecond) {
+  return fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n",
+                 style->width * style->scale, style->height * style->scale,
+                 framesPerSecond) > 0;
+}
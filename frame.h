@@ -0,0 +1,47 @@
+#ifndef GOL_FRAME_H
+#define GOL_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "rule.h"
+
+typedef enum {
+  FRAME_PPM, // Binary PPM image
+  FRAME_PNG, // Paletted PNG image
+  FRAME_Y4M, // Frame of a raw YUV4MPEG2 stream
+} FrameFormat;
+
+// How boards are drawn into frames: a square block of pixels per cell,
+// colored by its state. Frames are always of the square cell grid.
+typedef struct {
+  int width, height; // Board size in cells
+  int scale;         // Pixels per cell side
+  int numStates;
+  uint8_t palette[RULE_MAX_STATES][3]; // RGB of each state
+} FrameStyle;
+
+// Encodes frames of one style and format. Each encoder owns its buffers, so
+// one per thread encodes in parallel.
+typedef struct {
+  FrameStyle style;
+  FrameFormat format;
+  uint8_t colors[RULE_MAX_STATES][3]; // Palette converted for the format
+  uint8_t *pixels; // PNG rows of state indices, each after a filter byte
+  uint8_t *out;    // Worst case sized output
+} FrameEncoder;
+
+bool initFrameEncoder(FrameEncoder *encoder, const FrameStyle *style,
+                      FrameFormat format);
+void freeFrameEncoder(FrameEncoder *encoder);
+
+// Encodes the cells, packed row-major without a ghost border, into
+// `encoder->out`. Returns the encoded size.
+size_t encodeFrame(FrameEncoder *encoder, const uint8_t *cells);
+
+// Starts a YUV4MPEG2 stream; encoded Y4M frames follow it.
+bool writeY4mHeader(FILE *file, const FrameStyle *style, int framesPerSecond);
+
+#endif // GOL_FRAME_H
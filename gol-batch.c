@@ -0,0 +1,150 @@
+// gol-batch checks the bit-sliced batch kernel against stepBoard and times
+// both: random boards are stepped once as a BoardBatch and once one at a
+// time, and every cell of the results must match.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+#include "board.h"
+#include "rule.h"
+
+#define DEFAULT_RULE "B3/S23"
+#define DEFAULT_SIZE 40
+#define DEFAULT_BOARDS 4096
+#define DEFAULT_GENERATIONS 64
+
+// splitmix64
+static uint64_t nextRandom(uint64_t *state) {
+  uint64_t value = (*state += 0x9E3779B97F4A7C15u);
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9u;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBu;
+  return value ^ (value >> 31);
+}
+
+static double getSeconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Fills every cell of the board alive with even odds.
+static void fillBoard(Board *board, uint64_t *state) {
+  for (int y = 0; y < board->height; y++) {
+    uint8_t *row = getBoardCell(board, 0, y);
+    for (int x = 0; x < board->width; x++)
+      row[x] = nextRandom(state) & 1;
+  }
+  rehashBoard(board);
+}
+
+static bool isSameBoard(const Board *a, const Board *b) {
+  for (int y = 0; y < a->height; y++) {
+    if (memcmp(getBoardCell(a, 0, y), getBoardCell(b, 0, y), a->width) != 0)
+      return false;
+  }
+  return a->hash == b->hash;
+}
+
+static void printUsage() {
+  fprintf(stderr, "Usage: gol-batch [--rule <rule>] [--size <w>x<h>] "
+                  "[--boards <n>] [--generations <n>]\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *ruleString = DEFAULT_RULE;
+  int width = DEFAULT_SIZE, height = DEFAULT_SIZE;
+  int boardCount = DEFAULT_BOARDS, generations = DEFAULT_GENERATIONS;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+      ruleString = argv[++i];
+    } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      char *end;
+      width = (int)strtol(argv[++i], &end, 10);
+      height = *end == 'x' ? (int)strtol(end + 1, &end, 10) : 0;
+      if (width <= 0 || height <= 0 || *end != '\0') {
+        printUsage();
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--boards") == 0 && i + 1 < argc) {
+      boardCount = (int)strtol(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--generations") == 0 && i + 1 < argc) {
+      generations = (int)strtol(argv[++i], nullptr, 10);
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+  if (boardCount < 1 || generations < 0) {
+    printUsage();
+    return 1;
+  }
+
+  Rule rule;
+  if (!parseRule(ruleString, &rule)) {
+    fprintf(stderr, "Couldn't parse rule: %s\n", ruleString);
+    return 1;
+  }
+  if (rule.numStates != 2 || !isLifeLikeNeighborhood(&rule)) {
+    fprintf(stderr, "Only two-state Life-like rules can be batched\n");
+    return 1;
+  }
+
+  BoardBatch batch;
+  Board *boards = calloc(boardCount, sizeof(Board));
+  Board result;
+  if (!boards || !initBoardBatch(&batch, width, height, boardCount, &rule) ||
+      !initBoard(&result, width, height, &rule)) {
+    fprintf(stderr, "Couldn't allocate %d boards\n", boardCount);
+    return 1;
+  }
+  uint64_t state = 0;
+  for (int i = 0; i < boardCount; i++) {
+    if (!initBoard(&boards[i], width, height, &rule)) {
+      fprintf(stderr, "Couldn't allocate %d boards\n", boardCount);
+      return 1;
+    }
+    fillBoard(&boards[i], &state);
+    loadBatchBoard(&batch, i, &boards[i]);
+  }
+
+  double start = getSeconds();
+  stepBoardBatch(&batch, generations);
+  double batchSeconds = getSeconds() - start;
+
+  start = getSeconds();
+  for (int i = 0; i < boardCount; i++) {
+    for (int generation = 0; generation < generations; generation++)
+      stepBoard(&boards[i]);
+  }
+  double boardSeconds = getSeconds() - start;
+
+  int mismatches = 0;
+  for (int i = 0; i < boardCount; i++) {
+    storeBatchBoard(&batch, i, &result);
+    if (!isSameBoard(&result, &boards[i]))
+      mismatches++;
+  }
+
+  char ruleName[RULE_STRING_MAX];
+  formatRule(&rule, ruleName, sizeof(ruleName));
+  printf("%d %dx%d boards of %s, %d generations\n", boardCount, width, height,
+         ruleName, generations);
+  printf("batch:    %8.1f ms\n", batchSeconds * 1e3);
+  printf("one by one: %6.1f ms (%.1fx)\n", boardSeconds * 1e3,
+         batchSeconds > 0 ? boardSeconds / batchSeconds : 0.0);
+  if (mismatches)
+    printf("%d boards differ from stepBoard\n", mismatches);
+  else
+    printf("Every board matches stepBoard\n");
+
+  for (int i = 0; i < boardCount; i++)
+    freeBoard(&boards[i]);
+  free(boards);
+  freeBoard(&result);
+  freeBoardBatch(&batch);
+  return mismatches ? 1 : 0;
+}
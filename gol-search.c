@@ -0,0 +1,222 @@
+// gol-search runs random soups to stabilization and counts the objects they
+// leave behind, like apgsearch. Soups are split over threads, each with its
+// own board and census, which are merged once every thread is done. A soup
+// only depends on the seed and its number, so a census can be reproduced on
+// any number of threads.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "board.h"
+#include "census.h"
+#include "cycle.h"
+#include "rule.h"
+
+#define DEFAULT_RULE "B3/S23"
+#define DEFAULT_SEED "gol"
+#define DEFAULT_SOUPS 10000
+#define SOUP_SIZE 16           // Side of the random square of a soup
+#define BOARD_SIZE 256         // Side of the board soups are run on
+#define MAX_GENERATIONS 16384  // Soups that haven't settled by then are skipped
+#define SHIP_CHECK_INTERVAL 32 // Generations between looking for escapees
+
+typedef struct {
+  // Inputs
+  const Rule *rule;
+  uint64_t seed;
+  uint64_t soupCount;
+  int threadIndex, threadCount;
+
+  // Outputs
+  Census census;
+  uint64_t unsettledSoups;
+  bool hasFailed;
+} SearchThread;
+
+// splitmix64
+static uint64_t nextRandom(uint64_t *state) {
+  uint64_t value = (*state += 0x9E3779B97F4A7C15u);
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9u;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBu;
+  return value ^ (value >> 31);
+}
+
+// FNV-1a
+static uint64_t hashSeed(const char *seed) {
+  uint64_t hash = 0xCBF29CE484222325u;
+  for (; *seed; seed++)
+    hash = (hash ^ (uint8_t)*seed) * 0x100000001B3u;
+  return hash;
+}
+
+// Fills the middle of a cleared board with soup number `soup` of the seed,
+// each cell alive with even odds.
+static void placeSoup(Board *board, uint64_t seed, uint64_t soup) {
+  uint64_t state = seed ^ nextRandom(&soup);
+  int left = (board->width - SOUP_SIZE) / 2;
+  int top = (board->height - SOUP_SIZE) / 2;
+  uint64_t bits = 0;
+  for (int i = 0; i < SOUP_SIZE * SOUP_SIZE; i++, bits >>= 1) {
+    if (i % 64 == 0)
+      bits = nextRandom(&state);
+    if (bits & 1)
+      setBoardCell(board, left + i % SOUP_SIZE, top + i / SOUP_SIZE, 1);
+  }
+}
+
+// Steps the board until it repeats, taking escaping spaceships off it on the
+// way. Returns the period, or 0 when it doesn't settle or on failure.
+static int runSoup(Board *board, ObjectSeparator *separator,
+                   CycleDetector *detector, Census *census, bool *hasFailed) {
+  clearCycleDetector(detector);
+  for (int generation = 1; generation <= MAX_GENERATIONS; generation++) {
+    stepBoard(board);
+    int period = updateCycleDetector(detector, board);
+    if (period)
+      return period;
+
+    if (generation % SHIP_CHECK_INTERVAL == 0) {
+      int removed = removeSpaceships(separator, board, census);
+      if (removed < 0) {
+        *hasFailed = true;
+        return 0;
+      }
+      if (removed)
+        clearCycleDetector(detector);
+    }
+  }
+  return 0;
+}
+
+static void *runSearchThread(void *data) {
+  SearchThread *search = data;
+  Board board;
+  ObjectSeparator separator;
+  CycleDetector detector;
+  if (!initBoard(&board, BOARD_SIZE, BOARD_SIZE, search->rule)) {
+    search->hasFailed = true;
+    return nullptr;
+  }
+  if (!initObjectSeparator(&separator, BOARD_SIZE, BOARD_SIZE,
+                           search->rule)) {
+    freeBoard(&board);
+    search->hasFailed = true;
+    return nullptr;
+  }
+
+  // Soups are dealt out round robin, so threads never need to agree on
+  // anything until the end.
+  for (uint64_t soup = search->threadIndex;
+       soup < search->soupCount && !search->hasFailed;
+       soup += search->threadCount) {
+    clearBoard(&board);
+    placeSoup(&board, search->seed, soup);
+    int period = runSoup(&board, &separator, &detector, &search->census,
+                         &search->hasFailed);
+    if (!period)
+      search->unsettledSoups++;
+    else if (!censusBoard(&separator, &board, period, &search->census))
+      search->hasFailed = true;
+  }
+
+  freeObjectSeparator(&separator);
+  freeBoard(&board);
+  return nullptr;
+}
+
+static void printUsage() {
+  fprintf(stderr, "Usage: gol-search [--rule <rule>] [--seed <seed>] "
+                  "[--soups <n>] [--threads <n>]\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *ruleString = DEFAULT_RULE;
+  const char *seed = DEFAULT_SEED;
+  uint64_t soupCount = DEFAULT_SOUPS;
+  long threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+      ruleString = argv[++i];
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = argv[++i];
+    } else if (strcmp(argv[i], "--soups") == 0 && i + 1 < argc) {
+      soupCount = strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threadCount = strtol(argv[++i], nullptr, 10);
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+  if (threadCount < 1)
+    threadCount = 1;
+
+  Rule rule;
+  if (!parseRule(ruleString, &rule)) {
+    fprintf(stderr, "Couldn't parse rule: %s\n", ruleString);
+    return 1;
+  }
+  if (rule.numStates != 2 || !isLifeLikeNeighborhood(&rule)) {
+    fprintf(stderr, "Only two-state Life-like rules can be searched\n");
+    return 1;
+  }
+
+  SearchThread *searches = calloc(threadCount, sizeof(SearchThread));
+  pthread_t *threads = calloc(threadCount, sizeof(pthread_t));
+  if (!searches || !threads) {
+    fprintf(stderr, "Couldn't allocate threads\n");
+    return 1;
+  }
+  int startedCount = 0;
+  for (; startedCount < threadCount; startedCount++) {
+    searches[startedCount] = (SearchThread){
+        .rule = &rule,
+        .seed = hashSeed(seed),
+        .soupCount = soupCount,
+        .threadIndex = startedCount,
+        .threadCount = (int)threadCount,
+    };
+    if (pthread_create(&threads[startedCount], nullptr, runSearchThread,
+                       &searches[startedCount]) != 0)
+      break;
+  }
+
+  // A thread that didn't start leaves its share of soups out.
+  bool hasFailed = startedCount < threadCount;
+  Census census = {0};
+  uint64_t unsettledSoups = 0;
+  for (int i = 0; i < startedCount; i++) {
+    pthread_join(threads[i], nullptr);
+    hasFailed = hasFailed || searches[i].hasFailed ||
+                !mergeCensus(&census, &searches[i].census);
+    unsettledSoups += searches[i].unsettledSoups;
+    freeCensus(&searches[i].census);
+  }
+  if (hasFailed) {
+    fprintf(stderr, "Search failed: out of memory or threads\n");
+    return 1;
+  }
+
+  CensusEntry *entries = sortCensus(&census);
+  if (!entries) {
+    fprintf(stderr, "Couldn't sort census\n");
+    return 1;
+  }
+  char ruleName[RULE_STRING_MAX];
+  formatRule(&rule, ruleName, sizeof(ruleName));
+  printf("# rule %s\n# seed %s\n# soups %llu\n# unsettled %llu\n", ruleName,
+         seed, (unsigned long long)soupCount,
+         (unsigned long long)unsettledSoups);
+  for (size_t i = 0; i < census.count; i++)
+    printf("%s %llu\n", entries[i].code, (unsigned long long)entries[i].count);
+
+  free(entries);
+  freeCensus(&census);
+  free(threads);
+  free(searches);
+  return 0;
+}
@@ -0,0 +1,281 @@
+#include "gpu.h"
+
+#include <string.h>
+
+// SPIR-V words of cells.vert and cells.frag, compiled by glslc at build time
+static const Uint32 vertexShaderCode[] =
+#include "cells.vert.inc"
+    ;
+static const Uint32 fragmentShaderCode[] =
+#include "cells.frag.inc"
+    ;
+
+// The View block of cells.frag, laid out as std140.
+typedef struct {
+  float origin[2];
+  float cellSize, gap;
+  Sint32 size[2];
+  Sint32 isDensity;
+  float scale;
+  SDL_FColor background, dead, alive;
+} GpuUniforms;
+
+static SDL_GPUShader *createShader(SDL_GPUDevice *device, const Uint32 *code,
+                                   size_t size, SDL_GPUShaderStage stage,
+                                   Uint32 samplerCount, Uint32 uniformCount) {
+  SDL_GPUShaderCreateInfo info = {
+      .code_size = size,
+      .code = (const Uint8 *)code,
+      .entrypoint = "main",
+      .format = SDL_GPU_SHADERFORMAT_SPIRV,
+      .stage = stage,
+      .num_samplers = samplerCount,
+      .num_uniform_buffers = uniformCount,
+  };
+  return SDL_CreateGPUShader(device, &info);
+}
+
+static SDL_GPUGraphicsPipeline *createPipeline(GpuView *view) {
+  SDL_GPUShader *vertex =
+      createShader(view->device, vertexShaderCode, sizeof(vertexShaderCode),
+                   SDL_GPU_SHADERSTAGE_VERTEX, 0, 0);
+  SDL_GPUShader *fragment = createShader(
+      view->device, fragmentShaderCode, sizeof(fragmentShaderCode),
+      SDL_GPU_SHADERSTAGE_FRAGMENT, 2, 1);
+  SDL_GPUGraphicsPipeline *pipeline = nullptr;
+  if (vertex && fragment) {
+    SDL_GPUColorTargetDescription target = {
+        .format = SDL_GetGPUSwapchainTextureFormat(view->device, view->window),
+    };
+    SDL_GPUGraphicsPipelineCreateInfo info = {
+        .vertex_shader = vertex,
+        .fragment_shader = fragment,
+        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
+        .target_info = {.color_target_descriptions = &target,
+                        .num_color_targets = 1},
+    };
+    pipeline = SDL_CreateGPUGraphicsPipeline(view->device, &info);
+  }
+
+  // The pipeline keeps what it needs of the shaders.
+  if (vertex)
+    SDL_ReleaseGPUShader(view->device, vertex);
+  if (fragment)
+    SDL_ReleaseGPUShader(view->device, fragment);
+  return pipeline;
+}
+
+static SDL_GPUTexture *createTexture(SDL_GPUDevice *device,
+                                     SDL_GPUTextureFormat format, int width,
+                                     int height) {
+  SDL_GPUTextureCreateInfo info = {
+      .type = SDL_GPU_TEXTURETYPE_2D,
+      .format = format,
+      .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER,
+      .width = (Uint32)width,
+      .height = (Uint32)height,
+      .layer_count_or_depth = 1,
+      .num_levels = 1,
+  };
+  return SDL_CreateGPUTexture(device, &info);
+}
+
+static int getWordCount(int cellCount) { return (cellCount + 31) / 32; }
+
+bool initGpuView(GpuView *view, SDL_Window *window, int width, int height,
+                 int maxCells, const SDL_FColor colors[3]) {
+  *view = (GpuView){
+      .window = window,
+      .width = width,
+      .height = height,
+      .maxCells = maxCells,
+      .background = colors[0],
+      .dead = colors[1],
+      .alive = colors[2],
+  };
+  view->device = SDL_CreateGPUDevice(SDL_GPU_SHADERFORMAT_SPIRV, false,
+                                     nullptr);
+  if (!view->device)
+    return false;
+  if (!SDL_ClaimWindowForGPUDevice(view->device, window)) {
+    SDL_DestroyGPUDevice(view->device);
+    view->device = nullptr;
+    return false;
+  }
+
+  view->pipeline = createPipeline(view);
+  view->cellTexture =
+      createTexture(view->device, SDL_GPU_TEXTUREFORMAT_R32_UINT,
+                    getWordCount(maxCells), maxCells);
+  view->densityTexture = createTexture(
+      view->device, SDL_GPU_TEXTUREFORMAT_R8_UNORM, maxCells, maxCells);
+  SDL_GPUSamplerCreateInfo samplerInfo = {
+      .min_filter = SDL_GPU_FILTER_NEAREST,
+      .mag_filter = SDL_GPU_FILTER_NEAREST,
+      .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_NEAREST,
+      .address_mode_u = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+      .address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+      .address_mode_w = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+  };
+  view->sampler = SDL_CreateGPUSampler(view->device, &samplerInfo);
+  size_t cellBytes = (size_t)getWordCount(maxCells) * maxCells * 4;
+  size_t densityBytes = (size_t)maxCells * maxCells;
+  SDL_GPUTransferBufferCreateInfo transferInfo = {
+      .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+      .size = (Uint32)SDL_max(cellBytes, densityBytes),
+  };
+  view->transfer = SDL_CreateGPUTransferBuffer(view->device, &transferInfo);
+  if (!view->pipeline || !view->cellTexture || !view->densityTexture ||
+      !view->sampler || !view->transfer) {
+    freeGpuView(view);
+    return false;
+  }
+  return true;
+}
+
+void freeGpuView(GpuView *view) {
+  if (!view->device)
+    return;
+  if (view->transfer)
+    SDL_ReleaseGPUTransferBuffer(view->device, view->transfer);
+  if (view->sampler)
+    SDL_ReleaseGPUSampler(view->device, view->sampler);
+  if (view->densityTexture)
+    SDL_ReleaseGPUTexture(view->device, view->densityTexture);
+  if (view->cellTexture)
+    SDL_ReleaseGPUTexture(view->device, view->cellTexture);
+  if (view->pipeline)
+    SDL_ReleaseGPUGraphicsPipeline(view->device, view->pipeline);
+  SDL_ReleaseWindowFromGPUDevice(view->device, view->window);
+  SDL_DestroyGPUDevice(view->device);
+  *view = (GpuView){0};
+}
+
+// Copies the filled part of the transfer buffer into a texture, and draws the
+// region from it. The window is a fixed size, so the swapchain is only ever
+// scaled, by the display's pixel density.
+static bool drawRegion(GpuView *view, const GpuRegion *region,
+                       SDL_GPUTexture *texture, int texelWidth,
+                       bool isDensity) {
+  SDL_GPUCommandBuffer *commands = SDL_AcquireGPUCommandBuffer(view->device);
+  if (!commands)
+    return false;
+  SDL_GPUTexture *swapchain;
+  Uint32 swapchainWidth, swapchainHeight;
+  if (!SDL_WaitAndAcquireGPUSwapchainTexture(commands, view->window,
+                                             &swapchain, &swapchainWidth,
+                                             &swapchainHeight)) {
+    SDL_CancelGPUCommandBuffer(commands);
+    return false;
+  }
+  if (!swapchain) // Minimized
+    return SDL_SubmitGPUCommandBuffer(commands);
+
+  bool hasCells = region->width > 0 && region->height > 0;
+  if (hasCells) {
+    SDL_GPUCopyPass *copy = SDL_BeginGPUCopyPass(commands);
+    SDL_GPUTextureTransferInfo source = {
+        .transfer_buffer = view->transfer,
+        .pixels_per_row = (Uint32)texelWidth,
+        .rows_per_layer = (Uint32)region->height,
+    };
+    SDL_GPUTextureRegion destination = {
+        .texture = texture,
+        .w = (Uint32)texelWidth,
+        .h = (Uint32)region->height,
+        .d = 1,
+    };
+    SDL_UploadToGPUTexture(copy, &source, &destination, true);
+    SDL_EndGPUCopyPass(copy);
+  }
+
+  SDL_GPUColorTargetInfo target = {
+      .texture = swapchain,
+      .clear_color = view->background,
+      .load_op = SDL_GPU_LOADOP_CLEAR,
+      .store_op = SDL_GPU_STOREOP_STORE,
+  };
+  SDL_GPURenderPass *pass = SDL_BeginGPURenderPass(commands, &target, 1,
+                                                   nullptr);
+  if (hasCells) {
+    GpuUniforms uniforms = {
+        .origin = {region->originX, region->originY},
+        .cellSize = region->cellSize,
+        .gap = region->gap,
+        .size = {region->width, region->height},
+        .isDensity = isDensity,
+        .scale = (float)swapchainWidth / view->width,
+        .background = view->background,
+        .dead = view->dead,
+        .alive = view->alive,
+    };
+    SDL_GPUTextureSamplerBinding bindings[2] = {
+        {.texture = view->cellTexture, .sampler = view->sampler},
+        {.texture = view->densityTexture, .sampler = view->sampler},
+    };
+    SDL_BindGPUGraphicsPipeline(pass, view->pipeline);
+    SDL_BindGPUFragmentSamplers(pass, 0, bindings, 2);
+    SDL_PushGPUFragmentUniformData(commands, 0, &uniforms, sizeof(uniforms));
+    SDL_DrawGPUPrimitives(pass, 3, 1, 0, 0);
+  }
+  SDL_EndGPURenderPass(pass);
+  return SDL_SubmitGPUCommandBuffer(commands);
+}
+
+// Regions past the textures are cut down to them.
+static GpuRegion clampRegion(const GpuView *view, const GpuRegion *region) {
+  GpuRegion clamped = *region;
+  clamped.width = SDL_clamp(clamped.width, 0, view->maxCells);
+  clamped.height = SDL_clamp(clamped.height, 0, view->maxCells);
+  return clamped;
+}
+
+bool drawGpuCells(GpuView *view, const Board *board, const GpuRegion *region) {
+  GpuRegion clamped = clampRegion(view, region);
+  int wordCount = getWordCount(clamped.width);
+  if (clamped.width > 0 && clamped.height > 0) {
+    Uint32 *words =
+        SDL_MapGPUTransferBuffer(view->device, view->transfer, true);
+    if (!words)
+      return false;
+    // Two states, so each cell is its own bit. Words of eight dead cells are
+    // skipped.
+    for (int y = 0; y < clamped.height; y++) {
+      const uint8_t *row =
+          getBoardCell(board, clamped.left, clamped.top + y);
+      Uint32 *packed = words + (size_t)y * wordCount;
+      memset(packed, 0, (size_t)wordCount * sizeof(Uint32));
+      for (int x = 0; x < clamped.width; x += 8) {
+        int end = SDL_min(x + 8, clamped.width);
+        uint64_t word;
+        if (end - x == 8 && (memcpy(&word, row + x, 8), !word))
+          continue;
+        for (int i = x; i < end; i++)
+          packed[i / 32] |= (Uint32)(row[i] != 0) << (i % 32);
+      }
+    }
+    SDL_UnmapGPUTransferBuffer(view->device, view->transfer);
+  }
+  return drawRegion(view, &clamped, view->cellTexture, wordCount, false);
+}
+
+bool drawGpuDensity(GpuView *view, const DensityPyramid *pyramid, int level,
+                    const GpuRegion *region) {
+  GpuRegion clamped = clampRegion(view, region);
+  if (clamped.width > 0 && clamped.height > 0) {
+    uint8_t *texels =
+        SDL_MapGPUTransferBuffer(view->device, view->transfer, true);
+    if (!texels)
+      return false;
+    for (int y = 0; y < clamped.height; y++) {
+      memcpy(texels + (size_t)y * clamped.width,
+             &pyramid->levels[level][(size_t)(clamped.top + y) *
+                                         pyramid->widths[level] +
+                                     clamped.left],
+             clamped.width);
+    }
+    SDL_UnmapGPUTransferBuffer(view->device, view->transfer);
+  }
+  return drawRegion(view, &clamped, view->densityTexture, clamped.width,
+                    true);
+}
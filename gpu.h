@@ -0,0 +1,51 @@
+#ifndef GOL_GPU_H
+#define GOL_GPU_H
+
+#include <SDL3/SDL.h>
+
+#include "board.h"
+#include "density.h"
+
+// Draws square boards of two-state rules with the SDL GPU API instead of the
+// renderer. Rather than a rect per cell, each frame uploads the cells in view
+// packed 32 to a texel, or a level of the density pyramid once cells are
+// under a pixel, and a fragment shader works out the cell, gap and color of
+// every pixel. The shaders are SPIR-V, so this needs a Vulkan device, which
+// lavapipe provides without a GPU. Built with GOL_GPU.
+typedef struct {
+  SDL_GPUDevice *device;
+  SDL_Window *window; // Claimed by the device
+  int width, height;  // Of the window, in the units of a region's origin
+  int maxCells;       // Widest and tallest region, in cells or texels
+  SDL_FColor background, dead, alive;
+
+  SDL_GPUGraphicsPipeline *pipeline;
+  SDL_GPUTexture *cellTexture;    // A bit per cell, R32_UINT
+  SDL_GPUTexture *densityTexture; // A byte per texel, R8_UNORM
+  SDL_GPUSampler *sampler;
+  SDL_GPUTransferBuffer *transfer; // Fits either texture
+} GpuView;
+
+// A part of the board, or of a density level, and where it goes.
+typedef struct {
+  int left, top, width, height; // In cells, or texels of the level
+  float originX, originY;       // Window position of the top left one
+  float cellSize, gap;          // Texels are drawn without a gap
+} GpuRegion;
+
+// Claims a `width` x `height` window. The colors are the background, the
+// dead and the live color. Returns false with the SDL error set when there's
+// no device that takes SPIR-V or the pipeline can't be built.
+bool initGpuView(GpuView *view, SDL_Window *window, int width, int height,
+                 int maxCells, const SDL_FColor colors[3]);
+void freeGpuView(GpuView *view);
+
+// Draws and presents a frame of the cells in `region`, over the background.
+// An empty region draws only the background.
+bool drawGpuCells(GpuView *view, const Board *board, const GpuRegion *region);
+
+// Same, with the region in texels of a density level.
+bool drawGpuDensity(GpuView *view, const DensityPyramid *pyramid, int level,
+                    const GpuRegion *region);
+
+#endif // GOL_GPU_H
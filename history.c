@@ -0,0 +1,220 @@
+#include "history.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_ZERO_RUN 3 // Shorter runs of zeros stay inside literals
+
+bool initHistory(History *history, int width, int height, size_t budget) {
+  size_t cellCount = (size_t)width * height;
+  *history = (History){.width = width, .height = height, .budget = budget};
+  if (!budget)
+    return true;
+
+  history->previous = malloc(cellCount);
+  history->scratch = malloc(cellCount);
+  history->encoded = malloc(2 * cellCount + 32);
+  if (!history->previous || !history->scratch || !history->encoded) {
+    freeHistory(history);
+    return false;
+  }
+  return true;
+}
+
+void freeHistory(History *history) {
+  clearHistory(history);
+  free(history->frames);
+  free(history->previous);
+  free(history->scratch);
+  free(history->encoded);
+  *history = (History){0};
+}
+
+void clearHistory(History *history) {
+  for (size_t i = 0; i < history->frameCount; i++)
+    free(history->frames[i].data);
+  history->frameCount = 0;
+  history->usedBytes = 0;
+}
+
+static uint8_t *writeVarint(uint8_t *out, size_t value) {
+  for (; value >= 0x80; value >>= 7)
+    *out++ = (uint8_t)(value | 0x80);
+  *out++ = (uint8_t)value;
+  return out;
+}
+
+static const uint8_t *readVarint(const uint8_t *in, size_t *value) {
+  *value = 0;
+  for (int shift = 0;; shift += 7) {
+    uint8_t byte = *in++;
+    *value |= (size_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return in;
+  }
+}
+
+// Codes the cells as alternating runs of zeros and literal bytes, each
+// preceded by its length. Returns the coded size.
+static size_t encodeRuns(const uint8_t *cells, size_t count, uint8_t *out) {
+  uint8_t *start = out;
+  size_t i = 0;
+  while (i < count) {
+    size_t zeros = 0;
+    while (i + zeros < count && cells[i + zeros] == 0)
+      zeros++;
+    i += zeros;
+
+    // Literals run until the next run of zeros worth skipping.
+    size_t literalStart = i;
+    while (i < count) {
+      size_t zeroRun = 0;
+      while (zeroRun < MIN_ZERO_RUN && i + zeroRun < count &&
+             cells[i + zeroRun] == 0)
+        zeroRun++;
+      if (zeroRun == MIN_ZERO_RUN || i + zeroRun == count)
+        break;
+      i += zeroRun + 1;
+    }
+
+    out = writeVarint(out, zeros);
+    out = writeVarint(out, i - literalStart);
+    memcpy(out, cells + literalStart, i - literalStart);
+    out += i - literalStart;
+  }
+  return out - start;
+}
+
+// Decodes runs onto the cells, XORing literals in for deltas and storing
+// them for keyframes, whose cells must start out zero.
+static void decodeRuns(const uint8_t *in, size_t size, uint8_t *cells,
+                       bool isDelta) {
+  const uint8_t *end = in + size;
+  while (in < end) {
+    size_t zeros, literals;
+    in = readVarint(in, &zeros);
+    in = readVarint(in, &literals);
+    cells += zeros;
+    if (isDelta) {
+      for (size_t i = 0; i < literals; i++)
+        cells[i] ^= in[i];
+    } else {
+      memcpy(cells, in, literals);
+    }
+    cells += literals;
+    in += literals;
+  }
+}
+
+// Drops the oldest keyframe and its deltas, while a newer keyframe is left.
+static bool dropOldestSegment(History *history) {
+  size_t count = 1;
+  while (count < history->frameCount && !history->frames[count].isKeyframe)
+    count++;
+  if (count == history->frameCount)
+    return false;
+
+  for (size_t i = 0; i < count; i++) {
+    history->usedBytes -= history->frames[i].size;
+    free(history->frames[i].data);
+  }
+  history->frameCount -= count;
+  memmove(history->frames, history->frames + count,
+          history->frameCount * sizeof(HistoryFrame));
+  return true;
+}
+
+bool recordHistory(History *history, const Board *board) {
+  if (!history->budget)
+    return true;
+
+  size_t width = history->width;
+  bool follows =
+      history->frameCount > 0 &&
+      board->generation ==
+          history->frames[history->frameCount - 1].generation + 1;
+  if (!follows)
+    clearHistory(history);
+
+  for (int y = 0; y < history->height; y++)
+    memcpy(history->scratch + y * width, getBoardCell(board, 0, y), width);
+
+  size_t cellCount = width * history->height;
+  bool isKeyframe = history->frameCount == 0 ||
+                    board->generation - history->lastKeyframe >=
+                        HISTORY_KEYFRAME_INTERVAL;
+  if (isKeyframe) {
+    memcpy(history->previous, history->scratch, cellCount);
+    history->lastKeyframe = board->generation;
+  } else {
+    for (size_t i = 0; i < cellCount; i++) {
+      uint8_t cell = history->scratch[i];
+      history->scratch[i] ^= history->previous[i];
+      history->previous[i] = cell;
+    }
+  }
+
+  if (history->frameCount == history->frameCapacity) {
+    size_t capacity = history->frameCapacity ? history->frameCapacity * 2 : 256;
+    HistoryFrame *frames =
+        realloc(history->frames, capacity * sizeof(HistoryFrame));
+    if (!frames) {
+      clearHistory(history);
+      return false;
+    }
+    history->frames = frames;
+    history->frameCapacity = capacity;
+  }
+
+  size_t size = encodeRuns(history->scratch, cellCount, history->encoded);
+  uint8_t *data = malloc(size ? size : 1);
+  if (!data) {
+    clearHistory(history);
+    return false;
+  }
+  memcpy(data, history->encoded, size);
+  history->frames[history->frameCount++] = (HistoryFrame){
+      .generation = board->generation,
+      .data = data,
+      .size = size,
+      .isKeyframe = isKeyframe,
+  };
+
+  history->usedBytes += size;
+  while (history->usedBytes > history->budget && dropOldestSegment(history))
+    ;
+  return true;
+}
+
+bool rewindHistory(History *history, Board *board, uint64_t generation) {
+  if (history->frameCount == 0 || generation < history->frames[0].generation ||
+      generation > history->frames[history->frameCount - 1].generation)
+    return false;
+
+  size_t target = generation - history->frames[0].generation;
+  size_t keyframe = target;
+  while (!history->frames[keyframe].isKeyframe)
+    keyframe--;
+
+  size_t width = history->width, cellCount = width * history->height;
+  memset(history->scratch, 0, cellCount);
+  for (size_t i = keyframe; i <= target; i++) {
+    const HistoryFrame *frame = &history->frames[i];
+    decodeRuns(frame->data, frame->size, history->scratch, i != keyframe);
+  }
+
+  for (int y = 0; y < history->height; y++)
+    memcpy(getBoardCell(board, 0, y), history->scratch + y * width, width);
+  board->generation = generation;
+  rehashBoard(board);
+
+  // Newer generations are forgotten.
+  for (size_t i = target + 1; i < history->frameCount; i++) {
+    history->usedBytes -= history->frames[i].size;
+    free(history->frames[i].data);
+  }
+  history->frameCount = target + 1;
+  history->lastKeyframe = history->frames[keyframe].generation;
+  memcpy(history->previous, history->scratch, cellCount);
+  return true;
+}
@@ -0,0 +1,54 @@
+#ifndef GOL_HISTORY_H
+#define GOL_HISTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+
+#define HISTORY_KEYFRAME_INTERVAL 32 // Generations between keyframes
+
+// One compressed generation: the cells themselves for keyframes, otherwise
+// the XOR of the cells with the previous generation.
+typedef struct {
+  uint64_t generation;
+  uint8_t *data;
+  size_t size;
+  bool isKeyframe;
+} HistoryFrame;
+
+// Past generations of a board, kept within a memory budget by dropping the
+// oldest keyframe along with its deltas. Frames are run length coded, which
+// mostly leaves the changed cells of each generation. Restoring a generation
+// decodes one keyframe and at most HISTORY_KEYFRAME_INTERVAL - 1 deltas.
+typedef struct {
+  int width, height;
+  size_t budget;    // Bytes of frame data to keep at most
+  size_t usedBytes; // Bytes of frame data kept
+
+  HistoryFrame *frames; // Consecutive generations, oldest first
+  size_t frameCount, frameCapacity;
+  uint64_t lastKeyframe; // Generation of the newest keyframe
+
+  uint8_t *previous; // Cells of the newest frame, without the ghost border
+  uint8_t *scratch;  // Cells being encoded or decoded
+  uint8_t *encoded;  // Worst case sized output of the encoder
+} History;
+
+// A budget of 0 keeps no history at all, and recording costs nothing.
+bool initHistory(History *history, int width, int height, size_t budget);
+void freeHistory(History *history);
+void clearHistory(History *history);
+
+// Records the board's current generation. Call after every step, load and
+// reset; history starts over whenever the generation doesn't directly follow
+// the newest one. Returns false when out of memory.
+bool recordHistory(History *history, const Board *board);
+
+// Restores an earlier generation onto the board and forgets the newer ones,
+// so that stepping again records a new future. Returns false when the
+// generation is no longer kept.
+bool rewindHistory(History *history, Board *board, uint64_t generation);
+
+#endif // GOL_HISTORY_H
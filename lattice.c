@@ -0,0 +1,241 @@
+#include "lattice.h"
+
+#define SQRT_3 1.7320508f
+
+void initLatticeLayout(LatticeLayout *layout, Lattice lattice, int width,
+                       int height, float maxWidth, float maxHeight) {
+  float cellSize, usedWidth, usedHeight;
+  switch (lattice) {
+  case LATTICE_SQUARE:
+  default:
+    cellSize = SDL_min(maxWidth / width, maxHeight / height);
+    usedWidth = cellSize * width;
+    usedHeight = cellSize * height;
+    break;
+  case LATTICE_HEXAGONAL: {
+    // Hexagons sit sqrt(3) sizes apart within a row and 1.5 sizes apart
+    // between rows, and each row starts half a hexagon left of the last.
+    float columns = width + (height - 1) / 2.0f;
+    float rows = 1.5f * (height - 1) + 2.0f;
+    cellSize = SDL_min(maxWidth / (SQRT_3 * columns), maxHeight / rows);
+    usedWidth = SQRT_3 * cellSize * columns;
+    usedHeight = cellSize * rows;
+    break;
+  }
+  case LATTICE_TRIANGULAR:
+    // Triangles share half their base width with each neighbor in the row.
+    cellSize = SDL_min(maxWidth / ((width + 1) / 2.0f),
+                       maxHeight / (height * SQRT_3 / 2.0f));
+    usedWidth = cellSize * (width + 1) / 2.0f;
+    usedHeight = cellSize * height * SQRT_3 / 2.0f;
+    break;
+  }
+
+  *layout = (LatticeLayout){
+      .lattice = lattice,
+      .width = width,
+      .height = height,
+      .cellSize = cellSize,
+      .originX = (maxWidth - usedWidth) / 2.0f,
+      .originY = (maxHeight - usedHeight) / 2.0f,
+  };
+}
+
+// Center of hexagon (0, 0). Row y is shifted y / 2 hexagons left of row 0.
+static SDL_FPoint getFirstHexagonCenter(const LatticeLayout *layout) {
+  float hexagonWidth = SQRT_3 * layout->cellSize;
+  float rowShift = (layout->height - 1) / 2.0f;
+  return (SDL_FPoint){
+      .x = layout->originX + hexagonWidth * (rowShift + 0.5f),
+      .y = layout->originY + layout->cellSize,
+  };
+}
+
+int getLatticeCellCorners(const LatticeLayout *layout, int x, int y, float gap,
+                          SDL_FPoint corners[LATTICE_MAX_CORNERS]) {
+  float size = layout->cellSize;
+  switch (layout->lattice) {
+  case LATTICE_SQUARE:
+  default: {
+    float left = layout->originX + x * size + gap / 2.0f;
+    float top = layout->originY + y * size + gap / 2.0f;
+    float right = left + size - gap;
+    float bottom = top + size - gap;
+    corners[0] = (SDL_FPoint){left, top};
+    corners[1] = (SDL_FPoint){right, top};
+    corners[2] = (SDL_FPoint){right, bottom};
+    corners[3] = (SDL_FPoint){left, bottom};
+    return 4;
+  }
+  case LATTICE_HEXAGONAL: {
+    SDL_FPoint first = getFirstHexagonCenter(layout);
+    float centerX = first.x + SQRT_3 * size * (x - y / 2.0f);
+    float centerY = first.y + 1.5f * size * y;
+    float radius = size - gap / SQRT_3;
+
+    // Clockwise from the top corner.
+    static const float unitCorners[6][2] = {
+        {0.0f, -1.0f},          {SQRT_3 / 2.0f, -0.5f}, {SQRT_3 / 2.0f, 0.5f},
+        {0.0f, 1.0f},           {-SQRT_3 / 2.0f, 0.5f}, {-SQRT_3 / 2.0f, -0.5f},
+    };
+    for (int i = 0; i < 6; i++) {
+      corners[i].x = centerX + radius * unitCorners[i][0];
+      corners[i].y = centerY + radius * unitCorners[i][1];
+    }
+    return 6;
+  }
+  case LATTICE_TRIANGULAR: {
+    float rowHeight = size * SQRT_3 / 2.0f;
+    float left = layout->originX + x * size / 2.0f;
+    float top = layout->originY + y * rowHeight;
+    bool pointsUp = ((x + y) & 1) == 0;
+    if (pointsUp) {
+      corners[0] = (SDL_FPoint){left + size / 2.0f, top};
+      corners[1] = (SDL_FPoint){left + size, top + rowHeight};
+      corners[2] = (SDL_FPoint){left, top + rowHeight};
+    } else {
+      corners[0] = (SDL_FPoint){left, top};
+      corners[1] = (SDL_FPoint){left + size, top};
+      corners[2] = (SDL_FPoint){left + size / 2.0f, top + rowHeight};
+    }
+
+    // Pull the corners towards the centroid so the edges move in by half the
+    // gap. A corner sits twice the inradius away from the centroid.
+    float inradius = size / (2.0f * SQRT_3);
+    float scale = SDL_max(0.0f, 1.0f - gap / 2.0f / inradius);
+    float centroidX = (corners[0].x + corners[1].x + corners[2].x) / 3.0f;
+    float centroidY = (corners[0].y + corners[1].y + corners[2].y) / 3.0f;
+    for (int i = 0; i < 3; i++) {
+      corners[i].x = centroidX + (corners[i].x - centroidX) * scale;
+      corners[i].y = centroidY + (corners[i].y - centroidY) * scale;
+    }
+    return 3;
+  }
+  }
+}
+
+// Turns a fractional cell coordinate into an index in [0, count], clamping
+// before converting so that far off coordinates can't overflow.
+static int clampCellIndex(float index, int count) {
+  return (int)SDL_clamp(index, 0.0f, (float)count);
+}
+
+void getLatticeVisibleRows(const LatticeLayout *layout, float width,
+                           float height, int *top, int *bottom) {
+  float size = layout->cellSize;
+  float first, last; // Fractional rows at the top and bottom edges
+  switch (layout->lattice) {
+  case LATTICE_SQUARE:
+  default:
+    first = -layout->originY / size;
+    last = (height - layout->originY) / size;
+    break;
+  case LATTICE_HEXAGONAL: {
+    // Hexagons reach a size above and below their centers.
+    float centerY = getFirstHexagonCenter(layout).y;
+    first = (-size - centerY) / (1.5f * size);
+    last = (height + size - centerY) / (1.5f * size);
+    break;
+  }
+  case LATTICE_TRIANGULAR: {
+    float rowHeight = size * SQRT_3 / 2.0f;
+    first = -layout->originY / rowHeight;
+    last = (height - layout->originY) / rowHeight;
+    break;
+  }
+  }
+  *top = clampCellIndex(SDL_floorf(first), layout->height);
+  *bottom = clampCellIndex(SDL_floorf(last) + 1, layout->height);
+}
+
+void getLatticeVisibleColumns(const LatticeLayout *layout, int y, float width,
+                              int *left, int *right) {
+  float size = layout->cellSize;
+  float first, last; // Fractional columns at the left and right edges
+  switch (layout->lattice) {
+  case LATTICE_SQUARE:
+  default:
+    first = -layout->originX / size;
+    last = (width - layout->originX) / size;
+    break;
+  case LATTICE_HEXAGONAL: {
+    // Hexagons reach half their width either side of their centers, and row
+    // y starts y / 2 hexagons left of row 0.
+    float hexagonWidth = SQRT_3 * size;
+    float centerX = getFirstHexagonCenter(layout).x;
+    first = (-hexagonWidth / 2.0f - centerX) / hexagonWidth + y / 2.0f;
+    last = (width + hexagonWidth / 2.0f - centerX) / hexagonWidth + y / 2.0f;
+    break;
+  }
+  case LATTICE_TRIANGULAR:
+    // Triangle x spans a whole base from x half bases in.
+    first = (-size - layout->originX) / (size / 2.0f);
+    last = (width - layout->originX) / (size / 2.0f);
+    break;
+  }
+  *left = clampCellIndex(SDL_floorf(first), layout->width);
+  *right = clampCellIndex(SDL_floorf(last) + 1, layout->width);
+}
+
+// Rounds fractional axial hexagon coordinates to the nearest hexagon.
+static void roundHexagon(float q, float r, int *roundedQ, int *roundedR) {
+  float s = -q - r;
+  float rq = SDL_roundf(q), rr = SDL_roundf(r), rs = SDL_roundf(s);
+  float dq = SDL_fabsf(rq - q), dr = SDL_fabsf(rr - r), ds = SDL_fabsf(rs - s);
+
+  if (dq > dr && dq > ds)
+    rq = -rr - rs;
+  else if (dr > ds)
+    rr = -rq - rs;
+
+  *roundedQ = (int)rq;
+  *roundedR = (int)rr;
+}
+
+bool getLatticeCellAtPoint(const LatticeLayout *layout, float px, float py,
+                           int *x, int *y) {
+  float size = layout->cellSize;
+  int cellX, cellY;
+  switch (layout->lattice) {
+  case LATTICE_SQUARE:
+  default:
+    cellX = (int)SDL_floorf((px - layout->originX) / size);
+    cellY = (int)SDL_floorf((py - layout->originY) / size);
+    break;
+  case LATTICE_HEXAGONAL: {
+    // Board cell (x, y) is axial hexagon (x - y, y).
+    SDL_FPoint first = getFirstHexagonCenter(layout);
+    float relativeX = px - first.x, relativeY = py - first.y;
+    float q = (SQRT_3 / 3.0f * relativeX - relativeY / 3.0f) / size;
+    float r = (2.0f / 3.0f * relativeY) / size;
+    int axialQ, axialR;
+    roundHexagon(q, r, &axialQ, &axialR);
+    cellX = axialQ + axialR;
+    cellY = axialR;
+    break;
+  }
+  case LATTICE_TRIANGULAR: {
+    // In units of half a base and one row, triangle x spans [x, x + 2] and is
+    // |u - (x + 1)| <= v wide at height v into its row when it points up.
+    float u = (px - layout->originX) / (size / 2.0f);
+    float v = (py - layout->originY) / (size * SQRT_3 / 2.0f);
+    cellY = (int)SDL_floorf(v);
+    float depth = v - cellY;
+
+    cellX = (int)SDL_floorf(u);
+    bool pointsUp = ((cellX + cellY) & 1) == 0;
+    float halfWidth = pointsUp ? depth : 1.0f - depth;
+    if (SDL_fabsf(u - (cellX + 1)) > halfWidth)
+      cellX--;
+    break;
+  }
+  }
+
+  if (cellX < 0 || cellX >= layout->width || cellY < 0 ||
+      cellY >= layout->height)
+    return false;
+
+  *x = cellX;
+  *y = cellY;
+  return true;
+}
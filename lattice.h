@@ -0,0 +1,46 @@
+#ifndef GOL_LATTICE_H
+#define GOL_LATTICE_H
+
+#include <SDL3/SDL.h>
+
+#define LATTICE_MAX_CORNERS 6
+
+typedef enum {
+  LATTICE_SQUARE,
+  LATTICE_HEXAGONAL,  // Pointy-top hexagons, each row sheared half a cell left
+  LATTICE_TRIANGULAR, // Alternating up and down triangles, (0, 0) points up
+} Lattice;
+
+// Placement of a width x height board of cells inside the render area.
+typedef struct {
+  Lattice lattice;
+  int width, height;
+  float cellSize; // Square side, hexagon circumradius or triangle side
+  float originX, originY;
+} LatticeLayout;
+
+// Fits the board into a maxWidth x maxHeight area, centered.
+void initLatticeLayout(LatticeLayout *layout, Lattice lattice, int width,
+                       int height, float maxWidth, float maxHeight);
+
+// Writes the corners of cell (x, y), inset by `gap`, in clockwise order, and
+// returns how many there are.
+int getLatticeCellCorners(const LatticeLayout *layout, int x, int y, float gap,
+                          SDL_FPoint corners[LATTICE_MAX_CORNERS]);
+
+// Finds the rows of cells that overlap the top left width x height of the
+// render area, [*top, *bottom). The range may take in a row past each end.
+void getLatticeVisibleRows(const LatticeLayout *layout, float width,
+                           float height, int *top, int *bottom);
+
+// Finds the cells of row y that overlap the left `width` of the render area,
+// [*left, *right). The range may take in a cell past each end.
+void getLatticeVisibleColumns(const LatticeLayout *layout, int y, float width,
+                              int *left, int *right);
+
+// Finds the cell containing a point in constant time. Returns false when the
+// point is outside the board.
+bool getLatticeCellAtPoint(const LatticeLayout *layout, float px, float py,
+                           int *x, int *y);
+
+#endif // GOL_LATTICE_H
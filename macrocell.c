@@ -0,0 +1,248 @@
+#include "macrocell.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MACROCELL_LINE_MAX 256
+#define LEAF_LEVEL 3
+#define LEAF_SIZE (1 << LEAF_LEVEL)
+
+// Reads a line, dropping whatever doesn't fit. Returns false at the end of
+// the file.
+static bool readLine(FILE *file, char *line, size_t size) {
+  if (!fgets(line, (int)size, file))
+    return false;
+
+  size_t length = strlen(line);
+  if (length > 0 && line[length - 1] != '\n') {
+    int c;
+    while ((c = fgetc(file)) != EOF && c != '\n')
+      ;
+  }
+  while (length > 0 && isspace((unsigned char)line[length - 1]))
+    line[--length] = '\0';
+  return true;
+}
+
+// Builds the node whose top left cell is (x, y) of a leaf.
+static uint32_t buildLeafSubnode(NodeTable *table,
+                                 const uint8_t cells[LEAF_SIZE][LEAF_SIZE],
+                                 int level, int x, int y) {
+  uint32_t children[4];
+  int half = 1 << (level - 1);
+  for (int i = 0; i < 4; i++) {
+    int childX = x + (i & 1) * half, childY = y + (i >> 1) * half;
+    if (level == 1) {
+      children[i] = cells[childY][childX];
+    } else {
+      children[i] = buildLeafSubnode(table, cells, level - 1, childX, childY);
+      if (children[i] == QUAD_INVALID)
+        return QUAD_INVALID;
+    }
+  }
+  return findNode(table, level, children);
+}
+
+// ..*$.*$*** is an 8 x 8 leaf: rows end at $, and trailing dead cells and
+// rows are left out.
+static uint32_t parseLeafLine(NodeTable *table, const char *line) {
+  uint8_t cells[LEAF_SIZE][LEAF_SIZE] = {0};
+  int x = 0, y = 0;
+  for (; *line; line++) {
+    if (*line == '$') {
+      x = 0;
+      y++;
+      continue;
+    }
+    if ((*line != '.' && *line != '*') || x >= LEAF_SIZE || y >= LEAF_SIZE)
+      return QUAD_INVALID;
+    cells[y][x++] = *line == '*';
+  }
+  return buildLeafSubnode(table, cells, LEAF_LEVEL, 0, 0);
+}
+
+// "4 1 2 0 3" is a level 4 node made of earlier lines 1, 2 and 3, with 0 for
+// empty quadrants. Level 1 nodes list cell states instead.
+static uint32_t parseNodeLine(NodeTable *table, const char *line,
+                              const uint32_t *lineNodes, uint32_t lineCount,
+                              int *level) {
+  char *end;
+  long parsedLevel = strtol(line, &end, 10);
+  if (end == line || parsedLevel < 1 || parsedLevel > QUAD_MAX_LEVEL)
+    return QUAD_INVALID;
+
+  uint32_t children[4];
+  for (int i = 0; i < 4; i++) {
+    const char *start = end;
+    unsigned long index = strtoul(start, &end, 10);
+    if (end == start)
+      return QUAD_INVALID;
+
+    if (parsedLevel == 1) {
+      if (index >= RULE_MAX_STATES)
+        return QUAD_INVALID;
+      children[i] = (uint32_t)index;
+    } else {
+      // Children come from earlier lines and are one level down.
+      if (index > lineCount)
+        return QUAD_INVALID;
+      children[i] = index ? lineNodes[index - 1] : QUAD_EMPTY;
+      if (children[i] != QUAD_EMPTY &&
+          table->nodes[children[i]].level != parsedLevel - 1)
+        return QUAD_INVALID;
+    }
+  }
+
+  *level = (int)parsedLevel;
+  return findNode(table, (int)parsedLevel, children);
+}
+
+bool readMacrocell(FILE *file, NodeTable *table, Macrocell *pattern) {
+  *pattern = (Macrocell){
+      .root = QUAD_EMPTY,
+      .level = MACROCELL_MIN_LEVEL,
+  };
+
+  char line[MACROCELL_LINE_MAX];
+  if (!readLine(file, line, sizeof(line)) || strncmp(line, "[M2]", 4) != 0)
+    return false;
+
+  // Table nodes of each line so far, as later lines refer to them by line.
+  uint32_t *lineNodes = nullptr;
+  uint32_t lineCount = 0, lineCapacity = 0;
+  bool ok = true;
+  while (ok && readLine(file, line, sizeof(line))) {
+    if (line[0] == '#') {
+      if (line[1] == 'R') {
+        const char *rule = line + 2;
+        while (isspace((unsigned char)*rule))
+          rule++;
+        size_t length = strcspn(rule, ":");
+        ok = length < sizeof(pattern->rule);
+        if (ok) {
+          memcpy(pattern->rule, rule, length);
+          pattern->rule[length] = '\0';
+        }
+      } else if (line[1] == 'G') {
+        pattern->generation = strtoull(line + 2, nullptr, 10);
+      }
+      continue;
+    }
+    if (line[0] == '\0')
+      continue;
+
+    if (lineCount == lineCapacity) {
+      uint32_t capacity = lineCapacity ? lineCapacity * 2 : 1024;
+      uint32_t *nodes = realloc(lineNodes, capacity * sizeof(uint32_t));
+      if (!nodes) {
+        ok = false;
+        break;
+      }
+      lineNodes = nodes;
+      lineCapacity = capacity;
+    }
+
+    int level = LEAF_LEVEL;
+    uint32_t node = isdigit((unsigned char)line[0])
+                        ? parseNodeLine(table, line, lineNodes, lineCount,
+                                        &level)
+                        : parseLeafLine(table, line);
+    ok = node != QUAD_INVALID;
+    lineNodes[lineCount++] = node;
+    pattern->root = node;
+    pattern->level = level;
+  }
+
+  free(lineNodes);
+  return ok && !ferror(file);
+}
+
+typedef struct {
+  FILE *file;
+  const NodeTable *table;
+  bool isTwoState;
+  uint32_t *lineNumbers; // Line each node was written on, 0 when not yet
+  uint32_t lineCount;
+} MacrocellWriter;
+
+static void writeLeafLine(MacrocellWriter *writer, uint32_t node) {
+  char line[LEAF_SIZE * (LEAF_SIZE + 1) + 2];
+  int length = 0, lastRowEnd = 0;
+  for (int y = 0; y < LEAF_SIZE; y++) {
+    int rowStart = length, rowEnd = length;
+    for (int x = 0; x < LEAF_SIZE; x++) {
+      bool isAlive = getNodeCell(writer->table, node, LEAF_LEVEL, x, y) != 0;
+      line[length++] = isAlive ? '*' : '.';
+      if (isAlive)
+        rowEnd = length;
+    }
+    length = rowEnd;
+    line[length++] = '$';
+    if (rowEnd > rowStart)
+      lastRowEnd = length;
+  }
+  line[lastRowEnd] = '\0';
+  fprintf(writer->file, "%s\n", line);
+}
+
+// Writes a node after its children and returns its line number.
+static uint32_t writeNode(MacrocellWriter *writer, uint32_t node, int level) {
+  if (node == QUAD_EMPTY)
+    return 0;
+  if (writer->lineNumbers[node])
+    return writer->lineNumbers[node];
+
+  const uint32_t *children = writer->table->nodes[node].children;
+  if (writer->isTwoState && level == LEAF_LEVEL) {
+    writeLeafLine(writer, node);
+  } else if (level == 1) {
+    fprintf(writer->file, "1 %u %u %u %u\n", children[0], children[1],
+            children[2], children[3]);
+  } else {
+    uint32_t lines[4];
+    for (int i = 0; i < 4; i++)
+      lines[i] = writeNode(writer, children[i], level - 1);
+    fprintf(writer->file, "%d %u %u %u %u\n", level, lines[0], lines[1],
+            lines[2], lines[3]);
+  }
+
+  writer->lineNumbers[node] = ++writer->lineCount;
+  return writer->lineCount;
+}
+
+bool writeMacrocell(FILE *file, const NodeTable *table, uint32_t root,
+                    int level, const Rule *rule, uint64_t generation) {
+  MacrocellWriter writer = {
+      .file = file,
+      .table = table,
+      .isTwoState = rule->numStates == 2,
+      .lineNumbers = calloc(table->nodeCount, sizeof(uint32_t)),
+  };
+  if (!writer.lineNumbers)
+    return false;
+
+  char ruleName[RULE_STRING_MAX];
+  formatRule(rule, ruleName, sizeof(ruleName));
+  fprintf(file, "[M2] (game-of-life)\n#R %s\n#G %" PRIu64 "\n", ruleName,
+          generation);
+  writeNode(&writer, root, level);
+
+  free(writer.lineNumbers);
+  return !ferror(file);
+}
+
+bool writeBoardMacrocell(FILE *file, const Board *board) {
+  NodeTable table;
+  if (!initNodeTable(&table))
+    return false;
+
+  int level = getBoardNodeLevel(board, MACROCELL_MIN_LEVEL);
+  uint32_t root = buildBoardNode(&table, board, level);
+  bool ok = root != QUAD_INVALID &&
+            writeMacrocell(file, &table, root, level, &board->rule,
+                           board->generation);
+  freeNodeTable(&table);
+  return ok;
+}
@@ -0,0 +1,37 @@
+#ifndef GOL_MACROCELL_H
+#define GOL_MACROCELL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "board.h"
+#include "quadtree.h"
+#include "rule.h"
+
+// Two-state nodes are written as 8 x 8 leaves, so roots need at least this
+// level.
+#define MACROCELL_MIN_LEVEL 3
+
+// A pattern stored as quadtree nodes, one line per distinct node.
+typedef struct {
+  uint32_t root;              // Node in the table, QUAD_EMPTY when empty
+  int level;                  // Level of the root
+  uint64_t generation;        // From #G, 0 when missing
+  char rule[RULE_STRING_MAX]; // From #R, empty when missing
+} Macrocell;
+
+// Reads a [M2] macrocell file into the node table, one lookup per line, so
+// loading takes time in proportion to the distinct nodes rather than the
+// cells. Returns false when the file is malformed or the table can't grow.
+bool readMacrocell(FILE *file, NodeTable *table, Macrocell *pattern);
+
+// Writes every node reachable from the root once, children first. Returns
+// false when writing fails.
+bool writeMacrocell(FILE *file, const NodeTable *table, uint32_t root,
+                    int level, const Rule *rule, uint64_t generation);
+
+// Writes the board, centered on the pattern origin like RLE positions.
+bool writeBoardMacrocell(FILE *file, const Board *board);
+
+#endif // GOL_MACROCELL_H
@@ -9,21 +9,59 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #define SDL_MAIN_USE_CALLBACKS 1
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
 
-#define FPS 20.0
+#include "board.h"
+#include "checkpoint.h"
+#include "cycle.h"
+#include "density.h"
+#ifdef GOL_GPU
+#include "gpu.h"
+#endif
+#include "history.h"
+#include "lattice.h"
+#include "macrocell.h"
+#include "metrics.h"
+#include "profiler.h"
+#include "recorder.h"
+#include "rle.h"
+#include "rule.h"
+#include "selection.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "trace.h"
+#include "undo.h"
+
+#define DEFAULT_RATE 20.0 // Generations per second, changed with + and -
+#define MIN_RATE 0.25
+#define MAX_RATE 1024.0
+#define CATCH_UP_SECONDS 0.25 // Most simulated time run at once after a hitch
 #define MAX_WIDTH 800
 #define MAX_HEIGHT 800
-#define GRID_SIZE_X 40
+#define GRID_SIZE_X 40 // Board size unless --size is given
 #define GRID_SIZE_Y 40
 #define GRID_GAP 1
-#define NUM_CELL_NEIGHBORS 8
+#define GAP_CELL_SIZE 4     // Smaller cells are drawn without a gap
+#define MAX_CELL_SIZE 64.0f // Closest zoom, unless the board fits closer
+#define MIN_LATTICE_CELL_SIZE 4.0f // Farthest zoom of hexagons and triangles
+#define ZOOM_STEP 1.25f     // Zoom of a notch of the mouse wheel
+#define MAP_TEXTURE_SIZE 1024 // Texels, enough for a window of pixels
+#define HEAT_GENERATIONS 64   // Age by which a cell has cooled to its color
+#define DEFAULT_RULE "B3/S23"
+#define SAVED_PATTERN_FILE "saved.rle"
+#define SAVED_MACROCELL_FILE "saved.mc"
+#define SAVED_SNAPSHOT_FILE "saved.golsnap"
+#define CHECKPOINT_SECONDS 60 // Used when no checkpoint interval is given
 
-#define CELL_WIDTH (((MAX_WIDTH) / (float)(GRID_SIZE_X)) - (GRID_GAP))
-#define CELL_HEIGHT (((MAX_WIDTH) / (float)(GRID_SIZE_Y)) - (GRID_GAP))
+// Most square cells in view while dead ones are drawn one by one, which is
+// down to GAP_CELL_SIZE, and while live ones are, which is down to a pixel
+#define MAX_VISIBLE_CELLS                                                      \
+  ((MAX_WIDTH / GAP_CELL_SIZE + 2) * (MAX_HEIGHT / GAP_CELL_SIZE + 2))
+#define MAX_DRAWN_CELLS ((MAX_WIDTH + 2) * (MAX_HEIGHT + 2))
 
 #define WITH_RENDER_COLOR(renderer, color)                                     \
   for (Uint8 or, og, ob, oa,                                                   \
@@ -38,189 +76,1102 @@ typedef struct {
   int r, g, b, a;
 } Color;
 
-typedef struct Cell {
-  bool isAlive;
-  SDL_FRect *frect;                           // Associated rendered cell.
-  struct Cell *neighbors[NUM_CELL_NEIGHBORS]; // The cells four neighbors
-  Color color;                                // Alive cell color
-  int x, y;                                   // Position
-} Cell;
-
+// Cell states live in the board. Everything here is render and editing data,
+// never touched while stepping.
 typedef struct {
-  SDL_FRect cellDrawList[GRID_SIZE_X * GRID_SIZE_Y];
-  size_t cellCount;
-  Cell cellMap[GRID_SIZE_X][GRID_SIZE_Y];
+  Board board;
+
+  // Shape and placement of the cells. The camera zooms and pans by scaling
+  // and moving it, between the zoom limits.
+  LatticeLayout layout;
+  float minCellSize, maxCellSize;
+  SDL_FRect cellDrawList[MAX_VISIBLE_CELLS]; // Dead cells in view
+  SDL_FRect *liveDrawList; // Other cells in view, MAX_DRAWN_CELLS by state
+
+  // Hexagonal and triangular cells in view are drawn as triangle fans, built
+  // every frame.
+  SDL_Vertex *cellVertices;
+  int *cellIndices;
+  size_t geometryCapacity; // In cells
+
+  // Zoomed out past a pixel per cell, square cells are drawn from a density
+  // pyramid through a streaming texture instead, as is the heat map.
+  DensityPyramid density;
+  SDL_Texture *mapTexture;
+
+  // The heat map colors cells by how long ago they last changed, through a
+  // palette indexed by age: live cells from hot to their color, dead ones
+  // from embers to theirs. The board keeps ages from when it's first shown.
+  bool isHeatShown;          // Toggled with H
+  Uint32 heatColors[2][256]; // ARGB8888 color of dead and other cells by age
+
+  // With --gpu the window is drawn by a fragment shader instead of the
+  // renderer, for square boards of two-state rules.
+  bool isDrawnOnGpu;
+#ifdef GOL_GPU
+  GpuView gpu;
+#endif
+
+  Color statePalette[RULE_MAX_STATES]; // Render color of each cell state
+  Uint32 densityColors[256];           // ARGB8888 color of each density
+
+  bool isOverlayShown; // Whether the profiler overlay is drawn, toggled with O
 
-  Cell *dragStartCell; // The starting cell of a drag event.
+  bool isDragging;              // Whether a drag started on a cell
+  int dragStartX, dragStartY;   // The starting cell of a drag event.
+  UndoBuffer undo;              // Edits of the current generation
+
+  // Shift+drag selects a rectangle of cells, from the start to the end cell
+  // inclusive. Ctrl+C copies it and Ctrl+X cuts it into the clipboard, which
+  // Ctrl+V pastes at the pointer and Ctrl+click stamps again.
+  bool isSelecting; // Whether a selecting drag is going on
+  bool hasSelection;
+  int selectionStartX, selectionStartY, selectionEndX, selectionEndY;
+  CellBlock clipboard;
 } MapSystem;
 
 typedef struct {
-  bool isAFixedUpdate; // Is true when a fixed-time update should trigger
-  uint64_t timestamp;
-  double fps;
+  uint64_t timestamp;         // When the timer last ticked
+  double rate;                // Generations per second while playing
+  double accumulatedSeconds;  // Time owed to the simulation, under a step
+  int dueSteps;               // Steps to run this frame
+  double stepProgress;        // How far into the next step, from 0 to 1
 
   bool isPlaying;      // User selected with P
   bool shouldRunFrame; // User selected with .
+
+  bool isHeadless;         // Steps as fast as possible without a window
+  uint64_t lastGeneration; // Quits after this generation, unless 0
+
+  Checkpointer checkpointer; // Idle unless --checkpoint is given
+  History history;           // Idle unless --history-mb is given
+  Recorder recorder;         // Idle unless --record is given
+  CycleDetector cycles;      // Tells when the board settles
+  StatsLog stats;            // Idle unless --stats is given
+  MetricsServer metrics;     // Idle unless --metrics is given
+  const char *tracePath;     // Written on T and on quit, if tracing
 } SimulationSystem;
 
+// A pattern file being loaded. It is opened before the board exists, since
+// the pattern may pick the rule.
+typedef struct {
+  FILE *file;
+  bool isMacrocell;
+  RleReader rle;       // RLE header and read buffer
+  NodeTable nodes;     // Macrocells are read whole into a node table
+  Macrocell macrocell;
+} PatternFile;
+
 static SDL_Window *g_window = nullptr;
 static SDL_Renderer *g_renderer = nullptr;
 static MapSystem g_map = {0};
 static SimulationSystem g_sim = {0};
-
+static Profiler g_profiler = {0};
 
 // Palette
+static const Color backgroundColor = {
+    .r = 33, .g = 33, .b = 33, .a = SDL_ALPHA_OPAQUE};
 static const Color deadCellColor = {
     .r = 56, .g = 59, .b = 64, .a = SDL_ALPHA_OPAQUE};
 static const Color aliveCellColor = {
     .r = 195, .g = 199, .b = 205, .a = SDL_ALPHA_OPAQUE};
+static const Color dyingCellColor = {
+    .r = 209, .g = 124, .b = 88, .a = SDL_ALPHA_OPAQUE};
+static const Color hotCellColor = {
+    .r = 255, .g = 222, .b = 133, .a = SDL_ALPHA_OPAQUE};
+static const Color selectionColor = {
+    .r = 92, .g = 164, .b = 255, .a = SDL_ALPHA_OPAQUE};
+
+// The opaque ARGB8888 color a share `t` of the way between two colors.
+static Uint32 getArgbBetween(const Color *from, const Color *to, float t) {
+  Uint32 r = from->r + (int)(t * (to->r - from->r));
+  Uint32 g = from->g + (int)(t * (to->g - from->g));
+  Uint32 b = from->b + (int)(t * (to->b - from->b));
+  return 0xFF000000u | r << 16 | g << 8 | b;
+}
+
+static SDL_FColor getArgbFColor(Uint32 argb) {
+  return (SDL_FColor){(argb >> 16 & 0xFF) / 255.0f, (argb >> 8 & 0xFF) / 255.0f,
+                      (argb & 0xFF) / 255.0f, (argb >> 24) / 255.0f};
+}
+
+// Dying states of Generations rules fade from the dying color towards the
+// dead color as they age.
+static void buildStatePalette(int numStates) {
+  g_map.statePalette[0] = deadCellColor;
+  g_map.statePalette[1] = aliveCellColor;
+
+  // States the rule lacks, which only unchecked snapshots hold, look alive.
+  for (int state = numStates; state < RULE_MAX_STATES; state++)
+    g_map.statePalette[state] = aliveCellColor;
+  for (int state = 2; state < numStates; state++) {
+    float t = (float)(state - 2) / (float)(numStates - 1);
+    g_map.statePalette[state] = (Color){
+        .r = dyingCellColor.r + (int)(t * (deadCellColor.r - dyingCellColor.r)),
+        .g = dyingCellColor.g + (int)(t * (deadCellColor.g - dyingCellColor.g)),
+        .b = dyingCellColor.b + (int)(t * (deadCellColor.b - dyingCellColor.b)),
+        .a = SDL_ALPHA_OPAQUE,
+    };
+  }
+
+  // Densities of the zoomed out map shade from the dead to the live color.
+  for (int density = 0; density < 256; density++) {
+    g_map.densityColors[density] =
+        getArgbBetween(&deadCellColor, &aliveCellColor, density / 255.0f);
+  }
+
+  // Changed cells cool down over HEAT_GENERATIONS.
+  for (int age = 0; age < 256; age++) {
+    float t = SDL_min(age, HEAT_GENERATIONS) / (float)HEAT_GENERATIONS;
+    g_map.heatColors[0][age] =
+        getArgbBetween(&dyingCellColor, &deadCellColor, t);
+    g_map.heatColors[1][age] =
+        getArgbBetween(&hotCellColor, &aliveCellColor, t);
+  }
+}
+
+static SDL_FColor getFColor(Color color) {
+  return (SDL_FColor){color.r / 255.0f, color.g / 255.0f, color.b / 255.0f,
+                      color.a / 255.0f};
+}
+
+static Lattice getRuleLattice(const Rule *rule) {
+  switch (rule->neighborhood) {
+  case NEIGHBORHOOD_HEXAGONAL:
+    return LATTICE_HEXAGONAL;
+  case NEIGHBORHOOD_TRIANGULAR:
+    return LATTICE_TRIANGULAR;
+  default:
+    return LATTICE_SQUARE;
+  }
+}
+
+// Gaps between cells are left out once cells get small.
+static float getCellGap() {
+  return g_map.layout.cellSize >= GAP_CELL_SIZE ? GRID_GAP : 0;
+}
+
+// Scales the cells by `factor` around a point of the window, which stays on
+// the same spot of the board.
+static void zoomCamera(float x, float y, float factor) {
+  LatticeLayout *layout = &g_map.layout;
+  float cellSize = layout->cellSize * factor;
+  cellSize = SDL_clamp(cellSize, g_map.minCellSize, g_map.maxCellSize);
+  factor = cellSize / layout->cellSize;
+  layout->originX = x - (x - layout->originX) * factor;
+  layout->originY = y - (y - layout->originY) * factor;
+  layout->cellSize = cellSize;
+}
+
+// Fits the whole board in the window. The camera can zoom out to half that
+// size, and in to MAX_CELL_SIZE. Hexagons and triangles are drawn one by one
+// however small, so they stop at MIN_LATTICE_CELL_SIZE, which keeps the
+// cells in view to what a window can show.
+static void resetCamera() {
+  initLatticeLayout(&g_map.layout, g_map.layout.lattice, g_map.board.width,
+                    g_map.board.height, MAX_WIDTH, MAX_HEIGHT);
+  g_map.minCellSize = g_map.layout.cellSize / 2;
+  if (g_map.layout.lattice != LATTICE_SQUARE)
+    g_map.minCellSize = SDL_max(g_map.minCellSize, MIN_LATTICE_CELL_SIZE);
+  g_map.maxCellSize = SDL_max(g_map.layout.cellSize, MAX_CELL_SIZE);
+  zoomCamera(MAX_WIDTH / 2.0f, MAX_HEIGHT / 2.0f, 1); // Into the limits
+}
+
+static void panCamera(float dx, float dy) {
+  g_map.layout.originX += dx;
+  g_map.layout.originY += dy;
+}
+
+// Reads a pattern's header, or all nodes of a macrocell.
+static bool openPatternFile(PatternFile *pattern, const char *path) {
+  const char *extension = SDL_strrchr(path, '.');
+  pattern->isMacrocell = extension && SDL_strcasecmp(extension, ".mc") == 0;
+  pattern->file = fopen(path, "rb");
+  if (!pattern->file)
+    return false;
+
+  if (!pattern->isMacrocell)
+    return openRleReader(&pattern->rle, pattern->file);
+  return initNodeTable(&pattern->nodes) &&
+         readMacrocell(pattern->file, &pattern->nodes, &pattern->macrocell);
+}
+
+// Returns the rule named by the pattern, or nullptr.
+static const char *getPatternRule(const PatternFile *pattern) {
+  const char *rule =
+      pattern->isMacrocell ? pattern->macrocell.rule : pattern->rle.rule;
+  return rule[0] != '\0' ? rule : nullptr;
+}
+
+// Puts the pattern on the board and closes it.
+static bool loadPatternFile(PatternFile *pattern, Board *board) {
+  bool loaded = true;
+  if (pattern->isMacrocell) {
+    drawNodeOnBoard(&pattern->nodes, pattern->macrocell.root,
+                    pattern->macrocell.level, board);
+    board->generation = pattern->macrocell.generation;
+    freeNodeTable(&pattern->nodes);
+  } else {
+    loaded = readRleCells(&pattern->rle, board);
+  }
+  fclose(pattern->file);
+  return loaded;
+}
+
+#ifdef GOL_GPU
+// Claims the window for drawing on the GPU, unless the board is one the
+// shader can't draw or there's no device for it, in which case the renderer
+// draws it as usual.
+static bool initGpuDrawing(const Rule *rule) {
+  if (getRuleLattice(rule) != LATTICE_SQUARE || rule->numStates != 2) {
+    SDL_Log("Only square two-state boards are drawn on the GPU");
+    return false;
+  }
+  const SDL_FColor colors[3] = {getFColor(backgroundColor),
+                                getFColor(deadCellColor),
+                                getFColor(aliveCellColor)};
+  if (!initGpuView(&g_map.gpu, g_window, MAX_WIDTH, MAX_HEIGHT,
+                   SDL_max(MAX_WIDTH, MAX_HEIGHT) + 2, colors)) {
+    SDL_Log("Couldn't draw on the GPU: %s", SDL_GetError());
+    return false;
+  }
+  SDL_Log("Drawing on the GPU, without the profiler overlay");
+  return true;
+}
+#endif
 
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
   SDL_SetAppMetadata("Conway's Game of Life", "1.0",
                      "com.risheit.game-of-life");
 
-  if (!SDL_Init(SDL_INIT_VIDEO)) {
-    SDL_Log("Couldn't initialize SDL: %s", SDL_GetError());
+  // Parse command line options
+  const char *ruleString = nullptr;
+  const char *patternPath = nullptr;
+  const char *snapshotPath = nullptr;
+  const char *checkpointPath = nullptr;
+  uint64_t checkpointGenerations = 0, checkpointSeconds = 0;
+  uint64_t historyMegabytes = 0;
+  const char *recordPath = nullptr;
+  const char *statsPath = nullptr;
+  const char *metricsPath = nullptr;
+  double rate = DEFAULT_RATE;
+  int width = GRID_SIZE_X, height = GRID_SIZE_Y;
+  bool hasSize = false;
+  bool isGpuRequested = false;
+  uint64_t recordEvery = 1, recordScale = 1, generationCount = 0;
+  RecordPolicy recordPolicy = RECORD_BLOCK;
+  int recordThreads = SDL_GetNumLogicalCPUCores() - 1;
+  for (int i = 1; i < argc; i++) {
+    if (SDL_strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+      ruleString = argv[++i];
+    } else if (SDL_strcmp(argv[i], "--pattern") == 0 && i + 1 < argc) {
+      patternPath = argv[++i];
+    } else if (SDL_strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+      snapshotPath = argv[++i];
+    } else if (SDL_strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+      checkpointPath = argv[++i];
+    } else if (SDL_strcmp(argv[i], "--checkpoint-generations") == 0 &&
+               i + 1 < argc) {
+      checkpointGenerations = SDL_strtoull(argv[++i], nullptr, 10);
+    } else if (SDL_strcmp(argv[i], "--checkpoint-seconds") == 0 &&
+               i + 1 < argc) {
+      checkpointSeconds = SDL_strtoull(argv[++i], nullptr, 10);
+    } else if (SDL_strcmp(argv[i], "--history-mb") == 0 && i + 1 < argc) {
+      historyMegabytes = SDL_strtoull(argv[++i], nullptr, 10);
+    } else if (SDL_strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordPath = argv[++i];
+    } else if (SDL_strcmp(argv[i], "--record-every") == 0 && i + 1 < argc) {
+      recordEvery = SDL_strtoull(argv[++i], nullptr, 10);
+    } else if (SDL_strcmp(argv[i], "--record-scale") == 0 && i + 1 < argc) {
+      recordScale = SDL_strtoull(argv[++i], nullptr, 10);
+    } else if (SDL_strcmp(argv[i], "--record-threads") == 0 &&
+               i + 1 < argc) {
+      recordThreads = (int)SDL_strtol(argv[++i], nullptr, 10);
+    } else if (SDL_strcmp(argv[i], "--record-policy") == 0 && i + 1 < argc) {
+      const char *policy = argv[++i];
+      if (SDL_strcmp(policy, "drop") == 0) {
+        recordPolicy = RECORD_DROP;
+      } else if (SDL_strcmp(policy, "block") == 0) {
+        recordPolicy = RECORD_BLOCK;
+      } else {
+        SDL_Log("Unknown record policy: %s", policy);
+        return SDL_APP_FAILURE;
+      }
+    } else if (SDL_strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+      statsPath = argv[++i];
+    } else if (SDL_strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+      metricsPath = argv[++i];
+    } else if (SDL_strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      g_sim.tracePath = argv[++i];
+    } else if (SDL_strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      // Given as <width>x<height>
+      char *end;
+      width = (int)SDL_strtol(argv[++i], &end, 10);
+      height = *end == 'x' ? (int)SDL_strtol(end + 1, &end, 10) : 0;
+      if (width <= 0 || height <= 0 || *end != '\0') {
+        SDL_Log("Couldn't parse size: %s", argv[i]);
+        return SDL_APP_FAILURE;
+      }
+      hasSize = true;
+    } else if (SDL_strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+      rate = SDL_strtod(argv[++i], nullptr);
+      rate = SDL_clamp(rate, MIN_RATE, MAX_RATE);
+    } else if (SDL_strcmp(argv[i], "--gpu") == 0) {
+      isGpuRequested = true;
+    } else if (SDL_strcmp(argv[i], "--headless") == 0) {
+      g_sim.isHeadless = true;
+    } else if (SDL_strcmp(argv[i], "--generations") == 0 && i + 1 < argc) {
+      generationCount = SDL_strtoull(argv[++i], nullptr, 10);
+    } else {
+      SDL_Log("Unknown option: %s", argv[i]);
+      return SDL_APP_FAILURE;
+    }
+  }
+
+  // A snapshot restores the whole board, rule included.
+  Rule rule;
+  if (snapshotPath) {
+    if (ruleString || patternPath || hasSize) {
+      SDL_Log("--snapshot can't be combined with --rule, --pattern or --size");
+      return SDL_APP_FAILURE;
+    }
+    if (!openSnapshot(snapshotPath, &g_map.board)) {
+      SDL_Log("Couldn't read snapshot: %s", snapshotPath);
+      return SDL_APP_FAILURE;
+    }
+    rule = g_map.board.rule;
+  }
+
+  // A pattern's own rule applies unless one is given explicitly.
+  static PatternFile pattern;
+  if (patternPath) {
+    if (!openPatternFile(&pattern, patternPath)) {
+      SDL_Log("Couldn't read pattern: %s", patternPath);
+      return SDL_APP_FAILURE;
+    }
+    if (!ruleString)
+      ruleString = getPatternRule(&pattern);
+  }
+  if (!snapshotPath && !ruleString)
+    ruleString = DEFAULT_RULE;
+
+  if (ruleString && !parseRule(ruleString, &rule)) {
+    SDL_Log("Couldn't parse rule: %s", ruleString);
+    return SDL_APP_FAILURE;
+  }
+  char ruleName[RULE_STRING_MAX];
+  formatRule(&rule, ruleName, sizeof(ruleName));
+  SDL_Log("Using rule %s", ruleName);
+  if (!snapshotPath && !fitsRuleLattice(&rule, width, height)) {
+    SDL_Log("Triangular rules need an even width and height, not %dx%d",
+            width, height);
     return SDL_APP_FAILURE;
   }
 
-  if (!SDL_CreateWindowAndRenderer("Game of Life", MAX_WIDTH, MAX_HEIGHT, 0,
-                                   &g_window, &g_renderer)) {
-    SDL_Log("Couldn't create window/renderer: %s", SDL_GetError());
+  // Headless runs only need events, to quit on Ctrl+C.
+  if (!SDL_Init(g_sim.isHeadless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO)) {
+    SDL_Log("Couldn't initialize SDL: %s", SDL_GetError());
     return SDL_APP_FAILURE;
   }
-  SDL_SetRenderLogicalPresentation(g_renderer, MAX_WIDTH, MAX_HEIGHT,
-                                   SDL_LOGICAL_PRESENTATION_LETTERBOX);
+
+  if (!g_sim.isHeadless) {
+    g_window = SDL_CreateWindow("Game of Life", MAX_WIDTH, MAX_HEIGHT, 0);
+    if (!g_window) {
+      SDL_Log("Couldn't create window: %s", SDL_GetError());
+      return SDL_APP_FAILURE;
+    }
+    if (isGpuRequested) {
+#ifdef GOL_GPU
+      g_map.isDrawnOnGpu = initGpuDrawing(&rule);
+#else
+      SDL_Log("GPU drawing is off in this build, see GOL_GPU");
+#endif
+    }
+    if (!g_map.isDrawnOnGpu) {
+      g_renderer = SDL_CreateRenderer(g_window, nullptr);
+      if (!g_renderer) {
+        SDL_Log("Couldn't create renderer: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+      }
+      SDL_SetRenderLogicalPresentation(g_renderer, MAX_WIDTH, MAX_HEIGHT,
+                                       SDL_LOGICAL_PRESENTATION_LETTERBOX);
+    }
+  }
+
+  // Threads started from here on are traced.
+  nameTraceThread("main");
+  if (g_sim.tracePath) {
+#ifdef GOL_PROFILE
+    startTracing();
+#else
+    SDL_Log("Tracing is off in this build, see GOL_PROFILE");
+#endif
+  }
 
   // Initialize simulation system
-  g_sim.fps = FPS;
+  g_sim.rate = rate;
   g_sim.timestamp = SDL_GetPerformanceCounter();
   g_sim.isPlaying = false;
-  g_sim.isAFixedUpdate = false;
 
   // initialize map system
-  g_map.cellCount = GRID_SIZE_X * GRID_SIZE_Y;
-  for (int j = 0; j < GRID_SIZE_Y; j++) {
-    for (int i = 0; i < GRID_SIZE_X; i++) {
-      SDL_FRect *cellFRect = &g_map.cellDrawList[GRID_SIZE_X * j + i];
-
-      // Rendered box sizes are smaller to account for margin and gap.
-      cellFRect->x = (GRID_GAP / 2.0) + i * (CELL_WIDTH + GRID_GAP);
-      cellFRect->y = (GRID_GAP / 2.0) + j * (CELL_HEIGHT + GRID_GAP);
-      cellFRect->w = CELL_WIDTH;
-      cellFRect->h = CELL_HEIGHT;
-
-      Cell *cell = &g_map.cellMap[i][j];
-      cell->frect = cellFRect;
-      cell->isAlive = false;
-      cell->color = aliveCellColor;
-      cell->x = i;
-      cell->y = j;
-
-      // Initialize cell neighbors L -> T -> R -> B, wrap around screen
-      int leftNeighborIndex = i - 1 < 0 ? GRID_SIZE_X - 1 : i - 1;
-      int rightNeighborIndex = i + 1 >= GRID_SIZE_X ? 0 : i + 1;
-      int topNeighborIndex = j - 1 < 0 ? GRID_SIZE_Y - 1 : j - 1;
-      int bottomNeighborIndex = j + 1 >= GRID_SIZE_Y ? 0 : j + 1;
-      cell->neighbors[0] = &g_map.cellMap[leftNeighborIndex][j];
-      cell->neighbors[1] = &g_map.cellMap[leftNeighborIndex][topNeighborIndex];
-      cell->neighbors[2] =
-          &g_map.cellMap[leftNeighborIndex][bottomNeighborIndex];
-      cell->neighbors[3] = &g_map.cellMap[rightNeighborIndex][j];
-      cell->neighbors[4] = &g_map.cellMap[rightNeighborIndex][topNeighborIndex];
-      cell->neighbors[5] =
-          &g_map.cellMap[rightNeighborIndex][bottomNeighborIndex];
-      cell->neighbors[6] = &g_map.cellMap[i][topNeighborIndex];
-      cell->neighbors[7] = &g_map.cellMap[i][bottomNeighborIndex];
+  if (!snapshotPath && !initBoard(&g_map.board, width, height, &rule)) {
+    SDL_Log("Couldn't allocate board");
+    return SDL_APP_FAILURE;
+  }
+  if (patternPath && !loadPatternFile(&pattern, &g_map.board)) {
+    SDL_Log("Couldn't read pattern: %s", patternPath);
+    return SDL_APP_FAILURE;
+  }
+  width = g_map.board.width;
+  height = g_map.board.height;
+  // Headless runs can't rewind, so they don't pay for history.
+  if (g_sim.isHeadless)
+    historyMegabytes = 0;
+  if (!initHistory(&g_sim.history, width, height, historyMegabytes << 20)) {
+    SDL_Log("Couldn't allocate history");
+    return SDL_APP_FAILURE;
+  }
+  recordHistory(&g_sim.history, &g_map.board);
+  if (!initUndoBuffer(&g_map.undo, width)) {
+    SDL_Log("Couldn't allocate undo buffer");
+    return SDL_APP_FAILURE;
+  }
+  if (checkpointPath) {
+    if (!checkpointGenerations && !checkpointSeconds)
+      checkpointSeconds = CHECKPOINT_SECONDS;
+    startCheckpointer(&g_sim.checkpointer, checkpointPath,
+                      checkpointGenerations, checkpointSeconds * 1000,
+                      &g_map.board);
+  }
+  buildStatePalette(rule.numStates);
+  if (recordPath) {
+    FrameStyle style = {
+        .width = width,
+        .height = height,
+        .scale = recordScale ? (int)recordScale : 1,
+        .numStates = rule.numStates,
+    };
+    for (int state = 0; state < rule.numStates; state++) {
+      const Color *color = &g_map.statePalette[state];
+      style.palette[state][0] = (uint8_t)color->r;
+      style.palette[state][1] = (uint8_t)color->g;
+      style.palette[state][2] = (uint8_t)color->b;
+    }
+    if (!startRecorder(&g_sim.recorder, recordPath, &style, recordEvery,
+                       recordPolicy, recordThreads,
+                       (int)SDL_ceil(g_sim.rate))) {
+      SDL_Log("Couldn't start recording: %s", SDL_GetError());
+      return SDL_APP_FAILURE;
+    }
+    recordFrame(&g_sim.recorder, &g_map.board);
+  }
+  if (statsPath) {
+    if (!openStatsLog(&g_sim.stats, statsPath)) {
+      SDL_Log("Couldn't write stats to %s, a .csv or .json file", statsPath);
+      return SDL_APP_FAILURE;
+    }
+    writeStatsLog(&g_sim.stats, &g_map.board);
+  }
+  if (metricsPath &&
+      !startMetricsServer(&g_sim.metrics, metricsPath, &g_map.board)) {
+    SDL_Log("Couldn't serve metrics: %s", SDL_GetError());
+    return SDL_APP_FAILURE;
+  }
+  if (generationCount)
+    g_sim.lastGeneration = g_map.board.generation + generationCount;
+  if (g_sim.isHeadless)
+    return SDL_APP_CONTINUE;
+
+  g_map.layout.lattice = getRuleLattice(&rule);
+  resetCamera();
+  if (g_map.isDrawnOnGpu) {
+    if (!initDensityPyramid(&g_map.density, width, height)) {
+      SDL_Log("Couldn't create density map");
+      return SDL_APP_FAILURE;
+    }
+  } else if (g_map.layout.lattice == LATTICE_SQUARE) {
+    g_map.liveDrawList = malloc(MAX_DRAWN_CELLS * sizeof(SDL_FRect));
+    g_map.mapTexture = SDL_CreateTexture(
+        g_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+        MAP_TEXTURE_SIZE, MAP_TEXTURE_SIZE);
+    if (!g_map.liveDrawList || !g_map.mapTexture ||
+        !SDL_SetTextureScaleMode(g_map.mapTexture, SDL_SCALEMODE_NEAREST) ||
+        !initDensityPyramid(&g_map.density, width, height)) {
+      SDL_Log("Couldn't create density map: %s", SDL_GetError());
+      return SDL_APP_FAILURE;
     }
   }
   return SDL_APP_CONTINUE;
 }
 
-// Draws the map as squares with a gap in between each
+// Finds the square cells in view, [left, right) x [top, bottom). Returns
+// false when there are none.
+static bool getVisibleCells(int *left, int *top, int *right, int *bottom) {
+  getLatticeVisibleRows(&g_map.layout, MAX_WIDTH, MAX_HEIGHT, top, bottom);
+  getLatticeVisibleColumns(&g_map.layout, 0, MAX_WIDTH, left, right);
+  return *left < *right && *top < *bottom;
+}
+
+// The square a cell is drawn as, smaller than the cell by the gap.
+static SDL_FRect getCellRect(int x, int y) {
+  const LatticeLayout *layout = &g_map.layout;
+  float size = layout->cellSize, gap = getCellGap();
+  return (SDL_FRect){
+      .x = layout->originX + x * size + gap / 2,
+      .y = layout->originY + y * size + gap / 2,
+      .w = size - gap,
+      .h = size - gap,
+  };
+}
+
+// Draws the map as squares with a gap in between each, or as one rectangle
+// once the cells are too small for gaps.
 static void drawMap() {
+  int left, top, right, bottom;
+  if (!getVisibleCells(&left, &top, &right, &bottom))
+    return;
+  if (g_map.isHeatShown && g_map.layout.cellSize >= 1)
+    return; // The heat map covers it
+
+  int count = 0;
+  if (g_map.layout.cellSize >= GAP_CELL_SIZE) {
+    for (int j = top; j < bottom; j++) {
+      for (int i = left; i < right; i++)
+        g_map.cellDrawList[count++] = getCellRect(i, j);
+    }
+  } else {
+    const LatticeLayout *layout = &g_map.layout;
+    float size = layout->cellSize;
+    g_map.cellDrawList[count++] = (SDL_FRect){
+        layout->originX + left * size, layout->originY + top * size,
+        (right - left) * size, (bottom - top) * size};
+  }
   WITH_RENDER_COLOR(g_renderer, deadCellColor) {
-    SDL_RenderFillRects(g_renderer, g_map.cellDrawList, g_map.cellCount);
+    SDL_RenderFillRects(g_renderer, g_map.cellDrawList, count);
   }
 }
 
-static void drawActiveCells() {
-  for (int j = 0; j < GRID_SIZE_Y; j++) {
-    for (int i = 0; i < GRID_SIZE_X; i++) {
-      Cell *cell = &g_map.cellMap[i][j];
-      if (cell->isAlive) {
-        WITH_RENDER_COLOR(g_renderer, cell->color) {
-          SDL_RenderFillRect(g_renderer, cell->frect);
+// Makes room for the triangle fans of `cellCount` cells.
+static bool reserveLatticeGeometry(size_t cellCount) {
+  if (cellCount <= g_map.geometryCapacity)
+    return true;
+  size_t capacity = SDL_max(cellCount, 2 * g_map.geometryCapacity);
+  SDL_Vertex *vertices = realloc(
+      g_map.cellVertices, capacity * LATTICE_MAX_CORNERS * sizeof(SDL_Vertex));
+  if (vertices)
+    g_map.cellVertices = vertices;
+  int *indices = realloc(g_map.cellIndices, capacity *
+                                                (LATTICE_MAX_CORNERS - 2) * 3 *
+                                                sizeof(int));
+  if (indices)
+    g_map.cellIndices = indices;
+  if (!vertices || !indices)
+    return false;
+  g_map.geometryCapacity = capacity;
+  return true;
+}
+
+// Hexagonal and triangular cells in view are drawn in a single batch, with
+// every cell colored by its state. Their fans are built anew each frame,
+// which costs as much as coloring them would, and only takes cells in view.
+static void drawLatticeCells() {
+  const LatticeLayout *layout = &g_map.layout;
+  float gap = getCellGap();
+  int top, bottom;
+  getLatticeVisibleRows(layout, MAX_WIDTH, MAX_HEIGHT, &top, &bottom);
+
+  int vertexCount = 0, indexCount = 0;
+  size_t cellCount = 0;
+  for (int j = top; j < bottom; j++) {
+    int left, right;
+    getLatticeVisibleColumns(layout, j, MAX_WIDTH, &left, &right);
+    if (!reserveLatticeGeometry(cellCount + (right - left)))
+      break;
+    cellCount += right - left;
+
+    const uint8_t *row = getBoardCell(&g_map.board, 0, j);
+    const uint8_t *ages = g_map.isHeatShown ? getBoardAge(&g_map.board, 0, j)
+                                            : nullptr;
+    for (int i = left; i < right; i++) {
+      SDL_FColor vertexColor =
+          g_map.isHeatShown
+              ? getArgbFColor(g_map.heatColors[row[i] != 0][ages[i]])
+              : getFColor(g_map.statePalette[row[i]]);
+      SDL_FPoint corners[LATTICE_MAX_CORNERS];
+      int cornerCount = getLatticeCellCorners(layout, i, j, gap, corners);
+      for (int k = 0; k < cornerCount; k++) {
+        g_map.cellVertices[vertexCount + k] =
+            (SDL_Vertex){.position = corners[k], .color = vertexColor};
+      }
+      for (int k = 1; k + 1 < cornerCount; k++) {
+        g_map.cellIndices[indexCount++] = vertexCount;
+        g_map.cellIndices[indexCount++] = vertexCount + k;
+        g_map.cellIndices[indexCount++] = vertexCount + k + 1;
+      }
+      vertexCount += cornerCount;
+    }
+  }
+  SDL_RenderGeometry(g_renderer, nullptr, g_map.cellVertices, vertexCount,
+                     g_map.cellIndices, indexCount);
+}
+
+// Picks the finest level of the density pyramid whose texels still cover a
+// pixel, and finds its texels in view, [left, right) x [top, bottom). Returns
+// false when there are none.
+static bool getVisibleDensity(int *level, int *left, int *top, int *right,
+                              int *bottom) {
+  const DensityPyramid *pyramid = &g_map.density;
+  const LatticeLayout *layout = &g_map.layout;
+  *level = 1;
+  while (*level + 1 < pyramid->levelCount &&
+         layout->cellSize * (1 << *level) < 1)
+    (*level)++;
+  float texelSize = layout->cellSize * (1 << *level);
+  *left = SDL_max(0, (int)SDL_floorf(-layout->originX / texelSize));
+  *top = SDL_max(0, (int)SDL_floorf(-layout->originY / texelSize));
+  *right = SDL_min(pyramid->widths[*level],
+                   (int)SDL_ceilf((MAX_WIDTH - layout->originX) / texelSize));
+  *bottom =
+      SDL_min(pyramid->heights[*level],
+              (int)SDL_ceilf((MAX_HEIGHT - layout->originY) / texelSize));
+  return *left < *right && *top < *bottom;
+}
+
+// Draws the board zoomed out past a pixel per cell from the density pyramid.
+// Only the texels in view are copied into the texture, which the renderer
+// scales up.
+static void drawDensityMap() {
+  DensityPyramid *pyramid = &g_map.density;
+  updateDensityPyramid(pyramid, &g_map.board);
+
+  const LatticeLayout *layout = &g_map.layout;
+  int level, left, top, right, bottom;
+  if (!getVisibleDensity(&level, &left, &top, &right, &bottom))
+    return;
+  float texelSize = layout->cellSize * (1 << level);
+
+  SDL_Rect area = {0, 0, right - left, bottom - top};
+  void *pixels;
+  int pitch;
+  if (!SDL_LockTexture(g_map.mapTexture, &area, &pixels, &pitch))
+    return;
+  for (int y = 0; y < area.h; y++) {
+    Uint32 *row = (Uint32 *)((uint8_t *)pixels + (size_t)y * pitch);
+    for (int x = 0; x < area.w; x++)
+      row[x] = g_map.densityColors[getDensity(pyramid, level, left + x,
+                                              top + y)];
+  }
+  SDL_UnlockTexture(g_map.mapTexture);
+
+  SDL_FRect source = {0, 0, area.w, area.h};
+  SDL_FRect destination = {layout->originX + left * texelSize,
+                           layout->originY + top * texelSize,
+                           area.w * texelSize, area.h * texelSize};
+  SDL_RenderTexture(g_renderer, g_map.mapTexture, &source, &destination);
+}
+
+// Draws the cells in view through the heat palette, a texel per cell of the
+// map texture, which the renderer scales up. Being one texture, the cells
+// have no gaps.
+static void drawHeatMap() {
+  int left, top, right, bottom;
+  if (!getVisibleCells(&left, &top, &right, &bottom))
+    return;
+
+  SDL_Rect area = {0, 0, right - left, bottom - top};
+  void *pixels;
+  int pitch;
+  if (!SDL_LockTexture(g_map.mapTexture, &area, &pixels, &pitch))
+    return;
+  for (int y = 0; y < area.h; y++) {
+    const uint8_t *cells = getBoardCell(&g_map.board, left, top + y);
+    const uint8_t *ages = getBoardAge(&g_map.board, left, top + y);
+    Uint32 *row = (Uint32 *)((uint8_t *)pixels + (size_t)y * pitch);
+    for (int x = 0; x < area.w; x++)
+      row[x] = g_map.heatColors[cells[x] != 0][ages[x]];
+  }
+  SDL_UnlockTexture(g_map.mapTexture);
+
+  const LatticeLayout *layout = &g_map.layout;
+  float size = layout->cellSize;
+  SDL_FRect source = {0, 0, area.w, area.h};
+  SDL_FRect destination = {layout->originX + left * size,
+                           layout->originY + top * size, area.w * size,
+                           area.h * size};
+  SDL_RenderTexture(g_renderer, g_map.mapTexture, &source, &destination);
+}
+
+// Goes over the cells in view that aren't dead, a tile of the board at a
+// time, skipping words of eight dead cells. Counts them by state, or when
+// given where each state's rects start, places their rects there.
+static void scanVisibleCells(int counts[RULE_MAX_STATES],
+                             int offsets[RULE_MAX_STATES]) {
+  int left, top, right, bottom;
+  if (!getVisibleCells(&left, &top, &right, &bottom))
+    return;
+
+  int numStates = g_map.board.rule.numStates;
+  int firstTileX = left - left % BOARD_TILE_SIZE;
+  int firstTileY = top - top % BOARD_TILE_SIZE;
+  for (int tileY = firstTileY; tileY < bottom; tileY += BOARD_TILE_SIZE) {
+    for (int tileX = firstTileX; tileX < right; tileX += BOARD_TILE_SIZE) {
+      // The part of the tile in view
+      int x0 = SDL_max(tileX, left);
+      int x1 = SDL_min(tileX + BOARD_TILE_SIZE, right);
+      int y0 = SDL_max(tileY, top);
+      int y1 = SDL_min(tileY + BOARD_TILE_SIZE, bottom);
+      for (int j = y0; j < y1; j++) {
+        const uint8_t *row = getBoardCell(&g_map.board, 0, j);
+        for (int wordX = x0; wordX < x1; wordX += 8) {
+          int wordEnd = SDL_min(wordX + 8, x1);
+          uint64_t word;
+          if (wordEnd - wordX == 8 && (memcpy(&word, row + wordX, 8), !word))
+            continue;
+          for (int i = wordX; i < wordEnd; i++) {
+            uint8_t state = row[i] < numStates ? row[i] : 1;
+            if (state == 0)
+              continue;
+            if (offsets)
+              g_map.liveDrawList[offsets[state]++] = getCellRect(i, j);
+            else
+              counts[state]++;
+          }
         }
       }
     }
   }
 }
 
+// Draws the cells in view that aren't dead, batched into a draw call per
+// state, or the density map once cells are under a pixel, or else the heat
+// map when shown. Either way the work is bounded by the window, not the
+// board.
+static void drawActiveCells() {
+  if (g_map.layout.cellSize < 1) {
+    drawDensityMap();
+    return;
+  }
+  if (g_map.isHeatShown) {
+    drawHeatMap();
+    return;
+  }
+
+  int counts[RULE_MAX_STATES] = {0}, offsets[RULE_MAX_STATES];
+  scanVisibleCells(counts, nullptr);
+  int numStates = g_map.board.rule.numStates;
+  for (int state = 0, offset = 0; state < numStates; state++) {
+    offsets[state] = offset;
+    offset += counts[state];
+  }
+  scanVisibleCells(counts, offsets);
+
+  for (int state = 1; state < numStates; state++) {
+    if (counts[state] == 0)
+      continue;
+    WITH_RENDER_COLOR(g_renderer, g_map.statePalette[state]) {
+      SDL_RenderFillRects(g_renderer,
+                          &g_map.liveDrawList[offsets[state] - counts[state]],
+                          counts[state]);
+    }
+  }
+}
+
+// The selected cells, width x height from (left, top).
+static void getSelection(int *left, int *top, int *width, int *height) {
+  *left = SDL_min(g_map.selectionStartX, g_map.selectionEndX);
+  *top = SDL_min(g_map.selectionStartY, g_map.selectionEndY);
+  *width = SDL_abs(g_map.selectionEndX - g_map.selectionStartX) + 1;
+  *height = SDL_abs(g_map.selectionEndY - g_map.selectionStartY) + 1;
+}
+
+// Outlines the selection, around the corners of its corner cells, which
+// bound it on every lattice.
+static void drawSelection() {
+  if (!g_map.hasSelection)
+    return;
+  int left, top, width, height;
+  getSelection(&left, &top, &width, &height);
+  SDL_FPoint corners[LATTICE_MAX_CORNERS];
+  getLatticeCellCorners(&g_map.layout, left, top, 0, corners);
+  SDL_FPoint min = corners[0], max = corners[0];
+  for (int k = 0; k < 4; k++) {
+    int x = k & 1 ? left + width - 1 : left;
+    int y = k & 2 ? top + height - 1 : top;
+    int cornerCount = getLatticeCellCorners(&g_map.layout, x, y, 0, corners);
+    for (int i = 0; i < cornerCount; i++) {
+      min.x = SDL_min(min.x, corners[i].x);
+      min.y = SDL_min(min.y, corners[i].y);
+      max.x = SDL_max(max.x, corners[i].x);
+      max.y = SDL_max(max.y, corners[i].y);
+    }
+  }
+  SDL_FRect rect = {min.x, min.y, max.x - min.x, max.y - min.y};
+  WITH_RENDER_COLOR(g_renderer, selectionColor) {
+    SDL_RenderRect(g_renderer, &rect);
+  }
+}
+
+#ifdef GOL_GPU
+// Hands the GPU the cells in view, or the density texels in view once cells
+// are under a pixel, and has it draw and present the frame.
+static void drawGpuFrame() {
+  const LatticeLayout *layout = &g_map.layout;
+  GpuRegion region = {0};
+  int level, left, top, right, bottom;
+  if (layout->cellSize < 1) {
+    updateDensityPyramid(&g_map.density, &g_map.board);
+    if (getVisibleDensity(&level, &left, &top, &right, &bottom)) {
+      float texelSize = layout->cellSize * (1 << level);
+      region = (GpuRegion){left, top, right - left, bottom - top,
+                           layout->originX + left * texelSize,
+                           layout->originY + top * texelSize, texelSize, 0};
+      drawGpuDensity(&g_map.gpu, &g_map.density, level, &region);
+      return;
+    }
+  } else if (getVisibleCells(&left, &top, &right, &bottom)) {
+    float size = layout->cellSize;
+    region = (GpuRegion){left, top, right - left, bottom - top,
+                         layout->originX + left * size,
+                         layout->originY + top * size, size, getCellGap()};
+  }
+  drawGpuCells(&g_map.gpu, &g_map.board, &region);
+}
+#endif
+
 typedef enum {
   CELL_SET_ALIVE,
   CELL_SET_DEAD,
   CELL_TOGGLE,
 } CellSetAction;
 
-Cell *getCellUnderPoint(float x, float y) {
-  SDL_FPoint point = {.x = x, .y = y};
-
-  for (int j = 0; j < GRID_SIZE_Y; j++) {
-    for (int i = 0; i < GRID_SIZE_X; i++) {
-      if (SDL_PointInRectFloat(&point, g_map.cellMap[i][j].frect)) {
-        return &g_map.cellMap[i][j];
-      }
-    }
-  }
-
-  return nullptr;
+// Finds the coordinates of the cell under a point. Returns false if there is
+// none.
+bool getCellUnderPoint(float x, float y, int *cellX, int *cellY) {
+  return getLatticeCellAtPoint(&g_map.layout, x, y, cellX, cellY);
 }
 
 void setCellUnderPoint(float x, float y, CellSetAction action) {
-  Cell *cell = getCellUnderPoint(x, y);
-  if (!cell)
+  int i, j;
+  if (!getCellUnderPoint(x, y, &i, &j))
     return;
 
-  SDL_Log("Selected cell (%d, %d)", cell->x, cell->y);
+  SDL_Log("Selected cell (%d, %d)", i, j);
 
+  uint8_t state = 0;
   switch (action) {
   case CELL_SET_ALIVE:
-    cell->isAlive = true;
+    state = 1;
     break;
   case CELL_SET_DEAD:
-    cell->isAlive = false;
+    state = 0;
     break;
   case CELL_TOGGLE:
-    cell->isAlive = !cell->isAlive;
+    state = *getBoardCell(&g_map.board, i, j) == 1 ? 0 : 1;
     break;
   }
+  setEditedCell(&g_map.undo, &g_map.board, i, j, state);
 }
 
 // Triggers on mouse button down. A regular mouse click is considered a
 // drag with no motion.
 void handleDragStart(SDL_MouseButtonEvent *button) {
-  g_map.dragStartCell = getCellUnderPoint(button->x, button->y);
+  g_map.isDragging = getCellUnderPoint(button->x, button->y, &g_map.dragStartX,
+                                       &g_map.dragStartY);
 }
 
 // On drag, set all dragged-over cells to the same state as the starting
 // cell of the drag motion. Cells should only be updated once.
 void handleDragMotion(SDL_MouseMotionEvent *motion) {
-  if (!g_map.dragStartCell)
+  // Changes outside an edit couldn't be undone.
+  if (!g_map.isDragging || !g_map.undo.isEditing)
     return;
 
-  CellSetAction action =
-      g_map.dragStartCell->isAlive ? CELL_SET_ALIVE : CELL_SET_DEAD;
+  uint8_t startState =
+      *getBoardCell(&g_map.board, g_map.dragStartX, g_map.dragStartY);
+  CellSetAction action = startState == 1 ? CELL_SET_ALIVE : CELL_SET_DEAD;
   setCellUnderPoint(motion->x, motion->y, action);
 }
 
-void handleSimulationReset() {
-  // Reset all cells to dead.
-  for (int j = 0; j < GRID_SIZE_Y; j++) {
-    for (int i = 0; i < GRID_SIZE_X; i++) {
-      g_map.cellMap[i][j].isAlive = false;
+void handleSelectionStart(SDL_MouseButtonEvent *button) {
+  g_map.isSelecting =
+      getCellUnderPoint(button->x, button->y, &g_map.selectionStartX,
+                        &g_map.selectionStartY);
+  g_map.hasSelection = g_map.isSelecting;
+  g_map.selectionEndX = g_map.selectionStartX;
+  g_map.selectionEndY = g_map.selectionStartY;
+}
+
+void handleSelectionMotion(SDL_MouseMotionEvent *motion) {
+  int x, y;
+  if (getCellUnderPoint(motion->x, motion->y, &x, &y)) {
+    g_map.selectionEndX = x;
+    g_map.selectionEndY = y;
+  }
+}
+
+// Finishes the open edit, telling when it was too big to be undone.
+void handleEditEnd() {
+  if (!endEdit(&g_map.undo))
+    SDL_Log("Out of memory to undo that edit, so older edits are forgotten");
+}
+
+// Copies the selection into the clipboard, and clears it from the board when
+// cutting, as one undoable edit.
+void handleSelectionCopy(bool isCut) {
+  if (!g_map.hasSelection) {
+    SDL_Log("Nothing selected, see Shift+drag");
+    return;
+  }
+  int left, top, width, height;
+  getSelection(&left, &top, &width, &height);
+  if (!copyCellBlock(&g_map.clipboard, &g_map.board, left, top, width,
+                     height)) {
+    SDL_Log("Couldn't copy %dx%d cells", width, height);
+    return;
+  }
+  if (isCut) {
+    g_sim.isPlaying = false;
+    clearCycleDetector(&g_sim.cycles);
+    beginEdit(&g_map.undo);
+    bool isCleared = clearBoardArea(&g_map.board, &g_map.undo, left, top,
+                                    width, height);
+    handleEditEnd();
+    if (!isCleared) {
+      SDL_Log("Couldn't cut %dx%d cells", width, height);
+      return;
     }
   }
+  SDL_Log("%s %dx%d cells", isCut ? "Cut" : "Copied", width, height);
+}
+
+// Pastes the clipboard with its top left cell under a point, as one undoable
+// edit, and selects what was pasted.
+void handlePaste(float x, float y) {
+  int left, top;
+  if (!g_map.clipboard.cells) {
+    SDL_Log("Nothing to paste, see Ctrl+C");
+    return;
+  }
+  if (!getCellUnderPoint(x, y, &left, &top))
+    return;
+
+  g_sim.isPlaying = false;
+  clearCycleDetector(&g_sim.cycles);
+  beginEdit(&g_map.undo);
+  stampCellBlock(&g_map.clipboard, &g_map.board, &g_map.undo, left, top);
+  handleEditEnd();
+
+  g_map.hasSelection = true;
+  g_map.selectionStartX = left;
+  g_map.selectionStartY = top;
+  g_map.selectionEndX =
+      SDL_min(left + g_map.clipboard.width, g_map.board.width) - 1;
+  g_map.selectionEndY =
+      SDL_min(top + g_map.clipboard.height, g_map.board.height) - 1;
+}
+
+void handleClipboardTurn(bool isClockwise) {
+  if (!g_map.clipboard.cells) {
+    SDL_Log("Nothing to turn, see Ctrl+C");
+    return;
+  }
+  if (!rotateCellBlock(&g_map.clipboard, isClockwise))
+    SDL_Log("Couldn't turn the clipboard");
+}
+
+void handleClipboardFlip(bool isVertical) {
+  if (!g_map.clipboard.cells) {
+    SDL_Log("Nothing to flip, see Ctrl+C");
+    return;
+  }
+  flipCellBlock(&g_map.clipboard, isVertical);
+}
+
+void handleSimulationReset() {
+  // Reset all cells to dead, one undoable edit.
+  beginEdit(&g_map.undo);
+  if (!clearBoardArea(&g_map.board, &g_map.undo, 0, 0, g_map.board.width,
+                      g_map.board.height))
+    SDL_Log("Couldn't reset %dx%d cells", g_map.board.width,
+            g_map.board.height);
+  handleEditEnd();
+
+  // Like any other edit, a reset keeps the generation, so that undoing it
+  // leaves the generation and history as they were.
+  clearCycleDetector(&g_sim.cycles);
+}
+
+void handleUndo(bool isRedo) {
+  bool done = isRedo ? redoEdit(&g_map.undo, &g_map.board)
+                     : undoEdit(&g_map.undo, &g_map.board);
+  if (!done)
+    SDL_Log("Nothing to %s", isRedo ? "redo" : "undo");
+  else
+    clearCycleDetector(&g_sim.cycles);
+}
+
+void handleSimulationRewind() {
+  uint64_t generation = g_map.board.generation;
+  if (!g_sim.history.budget) {
+    SDL_Log("No history kept, see --history-mb");
+  } else if (generation == 0 ||
+      !rewindHistory(&g_sim.history, &g_map.board, generation - 1)) {
+    SDL_Log("No history before generation %llu",
+            (unsigned long long)generation);
+  } else {
+    clearUndoBuffer(&g_map.undo);
+    recordFrame(&g_sim.recorder, &g_map.board);
+  }
+}
+
+void handleSnapshotSave() {
+  if (writeSnapshot(SAVED_SNAPSHOT_FILE, &g_map.board))
+    SDL_Log("Saved snapshot to %s", SAVED_SNAPSHOT_FILE);
+  else
+    SDL_Log("Couldn't save snapshot to %s", SAVED_SNAPSHOT_FILE);
+}
+
+void handlePatternSave(bool asMacrocell) {
+  const char *path = asMacrocell ? SAVED_MACROCELL_FILE : SAVED_PATTERN_FILE;
+  FILE *file = fopen(path, "wb");
+  bool saved = file && (asMacrocell ? writeBoardMacrocell(file, &g_map.board)
+                                    : writeRle(file, &g_map.board));
+  if (file && fclose(file) != 0)
+    saved = false;
+
+  if (saved)
+    SDL_Log("Saved pattern to %s", path);
+  else
+    SDL_Log("Couldn't save pattern to %s", path);
+}
+
+void handleTraceSave() {
+  if (!g_sim.tracePath)
+    SDL_Log("Not tracing, see --trace");
+  else if (writeChromeTrace(g_sim.tracePath))
+    SDL_Log("Saved trace to %s", g_sim.tracePath);
+  else
+    SDL_Log("Couldn't save trace to %s", g_sim.tracePath);
+}
+
+// Ages are only kept once the heat map is first shown, so that stepping
+// doesn't pay for them before.
+void handleHeatToggle() {
+  if (g_map.isDrawnOnGpu) {
+    SDL_Log("The heat map isn't drawn on the GPU");
+    return;
+  }
+  if (!g_map.board.ages && !trackBoardAges(&g_map.board)) {
+    SDL_Log("Couldn't allocate cell ages");
+    return;
+  }
+  g_map.isHeatShown = !g_map.isHeatShown;
+}
+
+void handleRateChange(bool isFaster) {
+  g_sim.rate = SDL_clamp(isFaster ? g_sim.rate * 2 : g_sim.rate / 2, MIN_RATE,
+                         MAX_RATE);
+  SDL_Log("Stepping %g generations per second", g_sim.rate);
 }
 
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
@@ -229,19 +1180,44 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
     return SDL_APP_SUCCESS;
   case SDL_EVENT_MOUSE_BUTTON_DOWN:
     SDL_MouseButtonEvent *button = &event->button;
-    if (button->button == SDL_BUTTON_LEFT) {
+    SDL_Keymod mod = SDL_GetModState();
+    if (button->button == SDL_BUTTON_LEFT && (mod & SDL_KMOD_SHIFT)) {
+      handleSelectionStart(button);
+    } else if (button->button == SDL_BUTTON_LEFT &&
+               (mod & (SDL_KMOD_CTRL | SDL_KMOD_GUI))) {
+      handlePaste(button->x, button->y); // Stamps the clipboard
+    } else if (button->button == SDL_BUTTON_LEFT) {
       g_sim.isPlaying = false;
+      clearCycleDetector(&g_sim.cycles);
+      beginEdit(&g_map.undo);
       setCellUnderPoint(button->x, button->y, CELL_TOGGLE);
       handleDragStart(button);
     }
     break;
+  case SDL_EVENT_MOUSE_BUTTON_UP:
+    // A click or drag is undone as a whole.
+    if (event->button.button == SDL_BUTTON_LEFT) {
+      handleEditEnd();
+      g_map.isDragging = false;
+      g_map.isSelecting = false;
+    }
+    break;
   case SDL_EVENT_MOUSE_MOTION:
     SDL_MouseMotionEvent *motion = &event->motion;
-    if (motion->state == SDL_BUTTON_LMASK) {
+    if (motion->state == SDL_BUTTON_LMASK && g_map.isSelecting) {
+      handleSelectionMotion(motion);
+    } else if (motion->state == SDL_BUTTON_LMASK) {
       g_sim.isPlaying = false;
       handleDragMotion(motion);
+    } else if (motion->state & (SDL_BUTTON_RMASK | SDL_BUTTON_MMASK)) {
+      // Right or middle drag to pan
+      panCamera(motion->xrel, motion->yrel);
     }
     break;
+  case SDL_EVENT_MOUSE_WHEEL: // Scroll to zoom around the pointer
+    zoomCamera(event->wheel.mouse_x, event->wheel.mouse_y,
+               SDL_powf(ZOOM_STEP, event->wheel.y));
+    break;
   case SDL_EVENT_KEY_DOWN:
     SDL_KeyboardEvent *key = &event->key;
     switch (key->key) {
@@ -251,27 +1227,85 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
     case SDLK_PERIOD: // "." to move forward one frame
       g_sim.shouldRunFrame = true;
       break;
+    case SDLK_COMMA: // "," to move back one frame
+      g_sim.isPlaying = false;
+      handleSimulationRewind();
+      break;
     case SDLK_R: // R to reset
       handleSimulationReset();
       break;
+    case SDLK_Z: // Ctrl+Z to undo, Ctrl+Shift+Z to redo
+      if (key->mod & (SDL_KMOD_CTRL | SDL_KMOD_GUI))
+        handleUndo(key->mod & SDL_KMOD_SHIFT);
+      break;
+    case SDLK_Y: // Ctrl+Y to redo
+      if (key->mod & (SDL_KMOD_CTRL | SDL_KMOD_GUI))
+        handleUndo(true);
+      break;
+    case SDLK_S: // S to save the board as an RLE pattern
+      handlePatternSave(false);
+      break;
+    case SDLK_M: // M to save the board as a macrocell
+      handlePatternSave(true);
+      break;
+    case SDLK_B: // B to save a binary snapshot of the board
+      handleSnapshotSave();
+      break;
+    case SDLK_HOME: // Home to fit the board in the window again
+      resetCamera();
+      break;
+    case SDLK_EQUALS: // + to step faster, - slower
+    case SDLK_PLUS:
+    case SDLK_KP_PLUS:
+      handleRateChange(true);
+      break;
+    case SDLK_MINUS:
+    case SDLK_KP_MINUS:
+      handleRateChange(false);
+      break;
+    case SDLK_C: // Ctrl+C to copy the selection, Ctrl+X to cut it
+    case SDLK_X:
+      if (key->mod & (SDL_KMOD_CTRL | SDL_KMOD_GUI))
+        handleSelectionCopy(key->key == SDLK_X);
+      break;
+    case SDLK_V: // Ctrl+V to paste at the pointer
+      if (key->mod & (SDL_KMOD_CTRL | SDL_KMOD_GUI)) {
+        float x, y;
+        SDL_GetMouseState(&x, &y);
+        handlePaste(x, y);
+      }
+      break;
+    case SDLK_LEFTBRACKET: // [ and ] to turn the clipboard
+    case SDLK_RIGHTBRACKET:
+      handleClipboardTurn(key->key == SDLK_RIGHTBRACKET);
+      break;
+    case SDLK_F: // F to flip the clipboard, Shift+F upside down
+      handleClipboardFlip(key->mod & SDL_KMOD_SHIFT);
+      break;
+    case SDLK_ESCAPE: // Escape to drop the selection
+      g_map.hasSelection = false;
+      break;
+    case SDLK_H: // H to show or hide the heat map
+      handleHeatToggle();
+      break;
+    case SDLK_T: // T to write the trace so far
+      handleTraceSave();
+      break;
+    case SDLK_O: // O to show or hide the profiler overlay
+#ifdef GOL_PROFILE
+      g_map.isOverlayShown = !g_map.isOverlayShown;
+#else
+      SDL_Log("Profiling is off in this build, see GOL_PROFILE");
+#endif
+      break;
     }
   }
 
   return SDL_APP_CONTINUE;
 }
 
-int getNumLiveNeighbors(Cell *cell) {
-  int numLiveNeighbors = 0;
-  for (int i = 0; i < NUM_CELL_NEIGHBORS; i++) {
-    if (cell->neighbors[i]->isAlive)
-      numLiveNeighbors++;
-  }
-
-  return numLiveNeighbors;
-}
-
 void simulateConwayIteration() {
-  // Rules:
+  // Rules (Conway's B3/S23, the default rule):
   // 1. Any live cell with fewer than two live neighbors dies, as if by
   // underpopulation.
   // 2. Any live cell with two or three live neighbors lives on to the next
@@ -280,86 +1314,157 @@ void simulateConwayIteration() {
   // overpopulation.
   // 4. Any dead cell with exactly three live neighbors becomes a live cell, as
   // if by reproduction.
+  // Generations rules additionally age failed survivors through dying states
+  // before they die.
 
   // TODO: Infinite board
   // Until then, wrap for edge cells.
+  stepBoard(&g_map.board);
+  recordHistory(&g_sim.history, &g_map.board);
+  recordFrame(&g_sim.recorder, &g_map.board);
+  writeStatsLog(&g_sim.stats, &g_map.board);
 
-  // Deaths and births happen after an iteration
-  Cell *cellsToBirth[GRID_SIZE_X * GRID_SIZE_Y] = {0};
-  int birthCount = 0;
-  Cell *cellsToKill[GRID_SIZE_X * GRID_SIZE_Y] = {0};
-  int deathCount = 0;
-
-  // Test cells
-  for (int j = 0; j < GRID_SIZE_Y; j++) {
-    for (int i = 0; i < GRID_SIZE_X; i++) {
-      Cell *cell = &g_map.cellMap[i][j];
-      int liveNeighbors = getNumLiveNeighbors(cell);
-
-      // Rule 1 and 3
-      if (cell->isAlive && (liveNeighbors < 2 || liveNeighbors > 3)) {
-        cellsToKill[deathCount] = cell;
-        deathCount++;
-      }
-      // Rule 4
-      else if (!cell->isAlive && liveNeighbors == 3) {
-        cellsToBirth[birthCount] = cell;
-        birthCount++;
-      }
-    }
-  }
+  // Edits are undone cell by cell, which only makes sense on the generation
+  // they were made in.
+  clearUndoBuffer(&g_map.undo);
 
-  // Update cells
-  for (int i = 0; i < birthCount; i++) {
-    cellsToBirth[i]->isAlive = true;
-  }
-  for (int i = 0; i < deathCount; i++) {
-    cellsToKill[i]->isAlive = false;
+  // Settling is reported once, when it happens.
+  int lastPeriod = g_sim.cycles.period;
+  int period = updateCycleDetector(&g_sim.cycles, &g_map.board);
+  if (period && period != lastPeriod) {
+    unsigned long long generation = g_map.board.generation;
+    if (g_map.board.hash == 0)
+      SDL_Log("Generation %llu: the board died out", generation);
+    else if (period == 1)
+      SDL_Log("Generation %llu: the board is a still life", generation);
+    else
+      SDL_Log("Generation %llu: the board oscillates with period %d",
+              generation, period);
   }
 }
 
+// Owes the simulation the time since the last tick and works out how many
+// whole steps are due. After a hitch at most CATCH_UP_SECONDS of steps are
+// run and the rest of the backlog is dropped, so a slow frame can't snowball
+// into ever more steps per frame.
 void tickSimulationTimer() {
-  static double accumulatedSeconds = 0;
-  double cycleTime = 1.0 / g_sim.fps;
-
   uint64_t lastTimestamp = g_sim.timestamp;
   g_sim.timestamp = SDL_GetPerformanceCounter();
-  double delta = g_sim.timestamp - lastTimestamp;
-  accumulatedSeconds += delta / SDL_GetPerformanceFrequency();
-
-  // Update at a fixed rate according to specified FPS
-  if (accumulatedSeconds > cycleTime) {
-    accumulatedSeconds -= cycleTime;
-    g_sim.isAFixedUpdate = true;
-  } else {
-    g_sim.isAFixedUpdate = false;
+  if (!g_sim.isPlaying) {
+    g_sim.accumulatedSeconds = 0;
+    g_sim.dueSteps = 0;
+    g_sim.stepProgress = 0;
+    return;
   }
+
+  double stepSeconds = 1.0 / g_sim.rate;
+  g_sim.accumulatedSeconds += (double)(g_sim.timestamp - lastTimestamp) /
+                              SDL_GetPerformanceFrequency();
+  double steps = SDL_floor(g_sim.accumulatedSeconds / stepSeconds);
+  g_sim.accumulatedSeconds -= steps * stepSeconds;
+  double maxSteps = SDL_max(1.0, SDL_floor(CATCH_UP_SECONDS * g_sim.rate));
+  g_sim.dueSteps = (int)SDL_min(steps, maxSteps);
+  g_sim.stepProgress = g_sim.accumulatedSeconds / stepSeconds;
+}
+
+// Hands the metrics server a snapshot when one is due.
+static void updateMetrics() {
+#ifdef GOL_PROFILE
+  updateMetricsServer(&g_sim.metrics, &g_map.board, &g_profiler);
+#else
+  updateMetricsServer(&g_sim.metrics, &g_map.board, nullptr);
+#endif
+}
+
+static bool hasReachedLastGeneration() {
+  return g_sim.lastGeneration && g_map.board.generation >= g_sim.lastGeneration;
 }
 
 SDL_AppResult SDL_AppIterate(void *appstate) {
-  SDL_SetRenderDrawColor(g_renderer, 33, 33, 33, SDL_ALPHA_OPAQUE);
-  SDL_RenderClear(g_renderer);
+  // Headless runs step once per iteration, without waiting for the timer.
+  if (g_sim.isHeadless) {
+    WITH_PROFILED_PHASE(&g_profiler, PHASE_SIMULATE) {
+      simulateConwayIteration();
+    }
+    updateCheckpointer(&g_sim.checkpointer, &g_map.board);
+    updateMetrics();
+    return hasReachedLastGeneration() ? SDL_APP_SUCCESS : SDL_APP_CONTINUE;
+  }
+
+#ifdef GOL_PROFILE
+  startProfiledFrame(&g_profiler, g_map.board.generation);
+#endif
 
   // Move to next update step
-  tickSimulationTimer();
+  WITH_PROFILED_PHASE(&g_profiler, PHASE_TICK) { tickSimulationTimer(); }
 
-  // Simulate next step if the time advanced last iteration
-  if ((g_sim.isPlaying || g_sim.shouldRunFrame) && g_sim.isAFixedUpdate) {
+  // Run the steps that fell due, or one when "." was pressed
+  int steps = g_sim.dueSteps;
+  if (g_sim.shouldRunFrame) {
     g_sim.shouldRunFrame = false;
-    simulateConwayIteration();
+    steps = SDL_max(steps, 1);
   }
-
-  // When the simulation is playing, automatically advance the time.
-  if (g_sim.isPlaying) {
-    g_sim.timestamp++;
+  if (steps > 0) {
+    WITH_PROFILED_PHASE(&g_profiler, PHASE_SIMULATE) {
+      for (int i = 0; i < steps && !hasReachedLastGeneration(); i++)
+        simulateConwayIteration();
+    }
+    if (hasReachedLastGeneration())
+      return SDL_APP_SUCCESS;
   }
+  updateCheckpointer(&g_sim.checkpointer, &g_map.board);
+  updateMetrics();
 
-  drawMap();
-  drawActiveCells();
-  SDL_RenderPresent(g_renderer);
+#ifdef GOL_GPU
+  if (g_map.isDrawnOnGpu) {
+    WITH_PROFILED_PHASE(&g_profiler, PHASE_DRAW_CELLS) { drawGpuFrame(); }
+    return SDL_APP_CONTINUE;
+  }
+#endif
+  SDL_SetRenderDrawColor(g_renderer, backgroundColor.r, backgroundColor.g,
+                         backgroundColor.b, backgroundColor.a);
+  SDL_RenderClear(g_renderer);
+  if (g_map.layout.lattice == LATTICE_SQUARE) {
+    WITH_PROFILED_PHASE(&g_profiler, PHASE_DRAW_MAP) { drawMap(); }
+    WITH_PROFILED_PHASE(&g_profiler, PHASE_DRAW_CELLS) { drawActiveCells(); }
+  } else {
+    WITH_PROFILED_PHASE(&g_profiler, PHASE_DRAW_CELLS) { drawLatticeCells(); }
+  }
+  drawSelection();
+#ifdef GOL_PROFILE
+  if (g_map.isOverlayShown)
+    drawProfilerOverlay(&g_profiler, g_renderer, 8, 8,
+                        (int)g_map.board.stats.population);
+#endif
+  WITH_PROFILED_PHASE(&g_profiler, PHASE_PRESENT) {
+    SDL_RenderPresent(g_renderer);
+  }
 
   return SDL_APP_CONTINUE;
 }
 
-void SDL_AppQuit(void *appstate, SDL_AppResult result) {}
+void SDL_AppQuit(void *appstate, SDL_AppResult result) {
+  stopCheckpointer(&g_sim.checkpointer, &g_map.board);
+  stopRecorder(&g_sim.recorder);
+  stopMetricsServer(&g_sim.metrics);
+  if (!closeStatsLog(&g_sim.stats))
+    SDL_Log("Couldn't write stats");
+#ifdef GOL_PROFILE
+  if (g_sim.tracePath) {
+    handleTraceSave();
+    stopTracing();
+  }
+#endif
+  freeHistory(&g_sim.history);
+  freeUndoBuffer(&g_map.undo);
+  freeCellBlock(&g_map.clipboard);
+  freeDensityPyramid(&g_map.density);
+#ifdef GOL_GPU
+  freeGpuView(&g_map.gpu);
+#endif
+  free(g_map.liveDrawList);
+  free(g_map.cellVertices);
+  free(g_map.cellIndices);
+  freeBoard(&g_map.board);
+}
 
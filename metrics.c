@@ -0,0 +1,352 @@
+#include "metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+#define METRICS_POLL_MILLISECONDS 100    // Between checks for quitting
+#define METRICS_CLIENT_MILLISECONDS 1000 // Longest wait on a client
+#define METRICS_REQUEST_MAX 4096
+#define METRICS_REPLY_MAX 65536
+
+// The body of a reply, cut short if it doesn't fit.
+typedef struct {
+  char *text;
+  size_t length, capacity;
+} Reply;
+
+static void appendReply(Reply *reply, const char *format, ...) {
+  if (reply->length >= reply->capacity)
+    return;
+  va_list arguments;
+  va_start(arguments, format);
+  int length = vsnprintf(reply->text + reply->length,
+                         reply->capacity - reply->length, format, arguments);
+  va_end(arguments);
+  if (length > 0)
+    reply->length += length;
+}
+
+static void appendMetric(Reply *reply, const char *name, const char *type,
+                         const char *help) {
+  appendReply(reply, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static double getTimevalSeconds(struct timeval time) {
+  return time.tv_sec + time.tv_usec / 1e6;
+}
+
+// Adds the CPU time of each thread and the resident memory, which Linux
+// tells through /proc.
+static void appendProcMetrics(Reply *reply) {
+#ifdef __linux__
+  DIR *tasks = opendir("/proc/self/task");
+  if (tasks) {
+    appendMetric(reply, "gol_thread_cpu_seconds_total", "counter",
+                 "CPU time of each thread.");
+    double ticksPerSecond = sysconf(_SC_CLK_TCK);
+    struct dirent *task;
+    while ((task = readdir(tasks))) {
+      if (task->d_name[0] == '.')
+        continue;
+
+      // Task names are thread ids, so longer ones aren't threads.
+      char path[64], name[32] = "", stat[512];
+      if (snprintf(path, sizeof(path), "/proc/self/task/%s/comm",
+                   task->d_name) >= (int)sizeof(path))
+        continue;
+      FILE *file = fopen(path, "r");
+      if (file) {
+        if (fgets(name, sizeof(name), file))
+          name[strcspn(name, "\n")] = '\0';
+        // Label values can't hold these unescaped.
+        for (char *c = name; *c; c++)
+          if (*c == '"' || *c == '\\')
+            *c = '_';
+        fclose(file);
+      }
+
+      // User and system time are the 14th and 15th fields, counted after
+      // the name, which may hold spaces.
+      if (snprintf(path, sizeof(path), "/proc/self/task/%s/stat",
+                   task->d_name) >= (int)sizeof(path))
+        continue;
+      file = fopen(path, "r");
+      if (!file)
+        continue;
+      size_t length = fread(stat, 1, sizeof(stat) - 1, file);
+      fclose(file);
+      stat[length] = '\0';
+      const char *fields = strrchr(stat, ')');
+      unsigned long long userTicks, systemTicks;
+      if (!fields || sscanf(fields + 1,
+                            " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+                            "%llu %llu",
+                            &userTicks, &systemTicks) != 2)
+        continue;
+      appendReply(reply,
+                  "gol_thread_cpu_seconds_total{thread=\"%s\",tid=\"%s\"} "
+                  "%.2f\n",
+                  name, task->d_name,
+                  (userTicks + systemTicks) / ticksPerSecond);
+    }
+    closedir(tasks);
+  }
+
+  FILE *file = fopen("/proc/self/statm", "r");
+  unsigned long long residentPages;
+  if (file) {
+    if (fscanf(file, "%*u %llu", &residentPages) == 1) {
+      appendMetric(reply, "process_resident_memory_bytes", "gauge",
+                   "Resident memory size in bytes.");
+      appendReply(reply, "process_resident_memory_bytes %llu\n",
+                  residentPages * (unsigned long long)sysconf(_SC_PAGESIZE));
+    }
+    fclose(file);
+  }
+#endif
+}
+
+static void formatMetrics(MetricsServer *server, Reply *reply) {
+  SDL_LockMutex(server->mutex);
+  MetricsSnapshot snapshot = server->snapshot;
+  SDL_UnlockMutex(server->mutex);
+
+  appendMetric(reply, "gol_engine_info", "gauge",
+               "Rule, stepping kernel and board size.");
+  appendReply(reply,
+              "gol_engine_info{rule=\"%s\",kernel=\"%s\",width=\"%d\","
+              "height=\"%d\"} 1\n",
+              server->rule, server->kernel, server->width, server->height);
+  appendMetric(reply, "gol_generation", "gauge", "Generation of the board.");
+  appendReply(reply, "gol_generation %llu\n",
+              (unsigned long long)snapshot.generation);
+  appendMetric(reply, "gol_generations_per_second", "gauge",
+               "Generations stepped per second, lately.");
+  appendReply(reply, "gol_generations_per_second %.2f\n",
+              snapshot.generationsPerSecond);
+  appendMetric(reply, "gol_population", "gauge", "Live cells.");
+  appendReply(reply, "gol_population %llu\n",
+              (unsigned long long)snapshot.stats.population);
+  appendMetric(reply, "gol_births", "gauge", "Cells born in the last step.");
+  appendReply(reply, "gol_births %llu\n",
+              (unsigned long long)snapshot.stats.births);
+  appendMetric(reply, "gol_deaths", "gauge", "Cells died in the last step.");
+  appendReply(reply, "gol_deaths %llu\n",
+              (unsigned long long)snapshot.stats.deaths);
+
+  if (snapshot.hasPhaseTimes) {
+    static const char *quantiles[3] = {"0.5", "0.95", "0.99"};
+    appendMetric(reply, "gol_phase_milliseconds", "summary",
+                 "Time taken by each phase of a frame, lately.");
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+      for (int i = 0; i < 3; i++)
+        appendReply(reply,
+                    "gol_phase_milliseconds{phase=\"%s\",quantile=\"%s\"} "
+                    "%.3f\n",
+                    getPhaseName(phase), quantiles[i],
+                    snapshot.phaseMilliseconds[phase][i]);
+    }
+  }
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    appendMetric(reply, "process_cpu_seconds_total", "counter",
+                 "User and system CPU time in seconds.");
+    appendReply(reply, "process_cpu_seconds_total %.2f\n",
+                getTimevalSeconds(usage.ru_utime) +
+                    getTimevalSeconds(usage.ru_stime));
+  }
+  appendProcMetrics(reply);
+}
+
+// Writes all of a buffer to a non-blocking socket, waiting a while for room.
+static bool sendAll(int client, const char *data, size_t size) {
+#ifdef MSG_NOSIGNAL
+  int flags = MSG_NOSIGNAL; // A client that hung up mustn't kill the app
+#else
+  int flags = 0;
+#endif
+  while (size > 0) {
+    struct pollfd poller = {.fd = client, .events = POLLOUT};
+    if (poll(&poller, 1, METRICS_CLIENT_MILLISECONDS) <= 0)
+      return false;
+    ssize_t sent = send(client, data, size, flags);
+    if (sent <= 0)
+      return false;
+    data += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+// Answers any request with the metrics, once it has arrived.
+static void serveClient(MetricsServer *server, int client, Reply *reply) {
+  fcntl(client, F_SETFL, O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+  setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &(int){1}, sizeof(int));
+#endif
+  char request[METRICS_REQUEST_MAX];
+  struct pollfd poller = {.fd = client, .events = POLLIN};
+  if (poll(&poller, 1, METRICS_CLIENT_MILLISECONDS) <= 0 ||
+      recv(client, request, sizeof(request), 0) <= 0)
+    return;
+
+  reply->length = 0;
+  formatMetrics(server, reply);
+  char header[128];
+  int headerLength =
+      snprintf(header, sizeof(header),
+               "HTTP/1.0 200 OK\r\n"
+               "Content-Type: text/plain; version=0.0.4\r\n"
+               "Content-Length: %zu\r\n\r\n",
+               reply->length);
+  if (sendAll(client, header, headerLength))
+    sendAll(client, reply->text, reply->length);
+}
+
+static int runMetricsServer(void *data) {
+  MetricsServer *server = data;
+  Reply reply = {.text = malloc(METRICS_REPLY_MAX),
+                 .capacity = METRICS_REPLY_MAX};
+  if (!reply.text)
+    return 1;
+
+  while (!atomic_load(&server->isQuitting)) {
+    struct pollfd poller = {.fd = server->listener, .events = POLLIN};
+    if (poll(&poller, 1, METRICS_POLL_MILLISECONDS) <= 0)
+      continue;
+    int client = accept(server->listener, nullptr, nullptr);
+    if (client < 0)
+      continue;
+    serveClient(server, client, &reply);
+    close(client);
+  }
+  free(reply.text);
+  return 0;
+}
+
+static void destroyMetricsServer(MetricsServer *server) {
+  if (server->listener >= 0) {
+    close(server->listener);
+    unlink(server->path);
+  }
+  if (server->mutex)
+    SDL_DestroyMutex(server->mutex);
+  *server = (MetricsServer){.listener = -1};
+}
+
+bool startMetricsServer(MetricsServer *server, const char *path,
+                        const Board *board) {
+  *server = (MetricsServer){
+      .path = path,
+      .listener = -1,
+      .kernel = isLifeLikeNeighborhood(&board->rule) ? "life-like" : "range",
+      .width = board->width,
+      .height = board->height,
+  };
+  formatRule(&board->rule, server->rule, sizeof(server->rule));
+
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    SDL_SetError("Socket path too long: %s", path);
+    return false;
+  }
+  strcpy(address.sun_path, path);
+
+  // Only a socket left behind by an earlier run is replaced.
+  struct stat status;
+  if (stat(path, &status) == 0 && S_ISSOCK(status.st_mode))
+    unlink(path);
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 ||
+      bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0) {
+    SDL_SetError("Couldn't listen on %s: %s", path, strerror(errno));
+    if (listener >= 0)
+      close(listener);
+    return false;
+  }
+  server->listener = listener;
+  if (listen(listener, 8) != 0 ||
+      fcntl(listener, F_SETFL, O_NONBLOCK) != 0) {
+    SDL_SetError("Couldn't listen on %s: %s", path, strerror(errno));
+    destroyMetricsServer(server);
+    return false;
+  }
+
+  server->snapshot.generation = board->generation;
+  server->snapshot.stats = board->stats;
+  server->mutex = SDL_CreateMutex();
+  if (!server->mutex) {
+    destroyMetricsServer(server);
+    return false;
+  }
+  server->thread = SDL_CreateThread(runMetricsServer, "metrics", server);
+  if (!server->thread) {
+    destroyMetricsServer(server);
+    return false;
+  }
+  return true;
+}
+
+void updateMetricsServer(MetricsServer *server, const Board *board,
+                         const Profiler *profiler) {
+  if (!server->thread)
+    return;
+  uint64_t now = SDL_GetTicks();
+  if (server->lastUpdateTicks &&
+      now - server->lastUpdateTicks < METRICS_UPDATE_MILLISECONDS)
+    return;
+
+  MetricsSnapshot snapshot = {
+      .generation = board->generation,
+      .stats = board->stats,
+  };
+
+  // Rewinds and resets count as no progress rather than negative.
+  if (server->lastUpdateTicks && now > server->rateTicks) {
+    uint64_t steps = board->generation > server->rateGeneration
+                         ? board->generation - server->rateGeneration
+                         : 0;
+    snapshot.generationsPerSecond =
+        steps * 1000.0 / (now - server->rateTicks);
+  }
+  server->rateTicks = now;
+  server->rateGeneration = board->generation;
+  server->lastUpdateTicks = now;
+
+  if (profiler) {
+    snapshot.hasPhaseTimes = true;
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+      getPhasePercentiles(profiler, phase, snapshot.phaseMilliseconds[phase]);
+  }
+
+  // A scrape in progress holds the lock for a moment; this snapshot is then
+  // skipped rather than waited for.
+  if (SDL_TryLockMutex(server->mutex)) {
+    server->snapshot = snapshot;
+    SDL_UnlockMutex(server->mutex);
+  }
+}
+
+void stopMetricsServer(MetricsServer *server) {
+  if (!server->thread)
+    return;
+  atomic_store(&server->isQuitting, true);
+  SDL_WaitThread(server->thread, nullptr);
+  destroyMetricsServer(server);
+}
@@ -0,0 +1,57 @@
+#ifndef GOL_METRICS_H
+#define GOL_METRICS_H
+
+#include <SDL3/SDL.h>
+#include <stdatomic.h>
+
+#include "board.h"
+#include "profiler.h"
+#include "rule.h"
+
+#define METRICS_UPDATE_MILLISECONDS 250 // Between snapshots of the app
+
+// What the server reports, as of the last update.
+typedef struct {
+  uint64_t generation;
+  double generationsPerSecond;
+  BoardStats stats;
+  bool hasPhaseTimes;
+  double phaseMilliseconds[PHASE_COUNT][3]; // p50, p95 and p99
+} MetricsSnapshot;
+
+// Serves metrics in the Prometheus text format over HTTP on a Unix domain
+// socket, e.g. to `curl --unix-socket <path> http://localhost/metrics`. The
+// app hands over a snapshot a few times a second, which is all it ever does;
+// the server thread polls the socket and formats replies on its own, adding
+// process and thread CPU time and memory use as it goes.
+typedef struct {
+  const char *path;
+  int listener;
+  SDL_Thread *thread;
+  SDL_Mutex *mutex; // Guards `snapshot`
+  atomic_bool isQuitting;
+
+  // Set up once
+  char rule[RULE_STRING_MAX];
+  const char *kernel;
+  int width, height;
+
+  MetricsSnapshot snapshot;
+  uint64_t lastUpdateTicks;
+  uint64_t rateTicks, rateGeneration; // Start of the rate's window
+} MetricsServer;
+
+// Listens on a new socket at `path`, replacing an old one. Returns false when
+// the socket or thread can't be made, with the SDL error set.
+bool startMetricsServer(MetricsServer *server, const char *path,
+                        const Board *board);
+
+// Takes a new snapshot if one is due. The profiler is nullptr in builds
+// without GOL_PROFILE. Never waits for the server.
+void updateMetricsServer(MetricsServer *server, const Board *board,
+                         const Profiler *profiler);
+
+// Stops serving and removes the socket.
+void stopMetricsServer(MetricsServer *server);
+
+#endif // GOL_METRICS_H
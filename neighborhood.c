@@ -0,0 +1,224 @@
+#include "neighborhood.h"
+
+#include <stdlib.h>
+
+bool initRangeCounter(RangeCounter *counter, int width, int height,
+                      const Rule *rule) {
+  // Triangular neighborhoods reach two cells to each side.
+  int border = rule->neighborhood == NEIGHBORHOOD_TRIANGULAR ? 2 : rule->range;
+  int extendedWidth = width + 2 * border;
+  int extendedHeight = height + 2 * border;
+
+  // Sum planes get a zero row on top and zero columns on both sides so that
+  // running sums never index outside of them. Only the interior is written
+  // afterwards, so the padding stays zero.
+  *counter = (RangeCounter){
+      .width = width,
+      .height = height,
+      .border = border,
+      .stride = extendedWidth + 2,
+  };
+  size_t sumCount = (size_t)counter->stride * (extendedHeight + 1);
+  counter->extended = malloc((size_t)extendedWidth * extendedHeight);
+
+  bool needsSums = rule->neighborhood == NEIGHBORHOOD_MOORE ||
+                   rule->neighborhood == NEIGHBORHOOD_VON_NEUMANN;
+  bool needsAntiSums = rule->neighborhood == NEIGHBORHOOD_VON_NEUMANN;
+  if (needsSums)
+    counter->sums = calloc(sumCount, sizeof(int32_t));
+  if (needsAntiSums)
+    counter->antiSums = calloc(sumCount, sizeof(int32_t));
+  if (!counter->extended || (needsSums && !counter->sums) ||
+      (needsAntiSums && !counter->antiSums)) {
+    freeRangeCounter(counter);
+    return false;
+  }
+  return true;
+}
+
+void freeRangeCounter(RangeCounter *counter) {
+  free(counter->extended);
+  free(counter->sums);
+  free(counter->antiSums);
+  *counter = (RangeCounter){0};
+}
+
+// Copies the live flags of the board into the extended plane, wrapping the
+// border on every side.
+static void fillExtendedPlane(RangeCounter *counter, const uint8_t *cells,
+                              ptrdiff_t stride) {
+  int range = counter->border;
+  int width = counter->width, height = counter->height;
+  int extendedWidth = width + 2 * range;
+
+  for (int j = 0; j < height + 2 * range; j++) {
+    int y = ((j - range) % height + height) % height;
+    const uint8_t *source = &cells[y * stride];
+    uint8_t *row = &counter->extended[(size_t)j * extendedWidth];
+    for (int x = 0; x < width; x++)
+      row[range + x] = source[x] == 1;
+    for (int i = 0; i < range; i++) {
+      row[i] = row[range + ((i - range) % width + width) % width];
+      row[range + width + i] = row[range + i % width];
+    }
+  }
+}
+
+// Sum planes index extended cell (i, j) at row j + 1 and column i + 1.
+#define SUM_AT(plane, i, j) ((plane)[((j) + 1) * (size_t)stride + (i) + 1])
+
+static void countMooreNeighbors(RangeCounter *counter, uint16_t *counts) {
+  int range = counter->border, stride = counter->stride;
+  int width = counter->width, height = counter->height;
+  int extendedWidth = width + 2 * range;
+  int32_t *sums = counter->sums;
+
+  for (int j = 0; j < height + 2 * range; j++) {
+    const uint8_t *row = &counter->extended[(size_t)j * extendedWidth];
+    int32_t rowSum = 0;
+    for (int i = 0; i < extendedWidth; i++) {
+      rowSum += row[i];
+      SUM_AT(sums, i, j) = SUM_AT(sums, i, j - 1) + rowSum;
+    }
+  }
+
+  // The box of cell (x, y) spans extended cells [x, x + 2R] x [y, y + 2R].
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      int right = x + 2 * range, bottom = y + 2 * range;
+      int32_t corners =
+          SUM_AT(sums, right, bottom) + SUM_AT(sums, x - 1, y - 1);
+      int32_t edges = SUM_AT(sums, x - 1, bottom) + SUM_AT(sums, right, y - 1);
+      counts[(size_t)y * width + x] = (uint16_t)(corners - edges);
+    }
+  }
+}
+
+static void countVonNeumannNeighbors(RangeCounter *counter, uint16_t *counts) {
+  int range = counter->border, stride = counter->stride;
+  int width = counter->width, height = counter->height;
+  int extendedWidth = width + 2 * range;
+  const uint8_t *extended = counter->extended;
+  int32_t *mainSums = counter->sums; // Running sums towards the top left
+  int32_t *antiSums = counter->antiSums; // Running sums towards the top right
+
+  for (int j = 0; j < height + 2 * range; j++) {
+    const uint8_t *row = &extended[(size_t)j * extendedWidth];
+    for (int i = 0; i < extendedWidth; i++) {
+      SUM_AT(mainSums, i, j) = row[i] + SUM_AT(mainSums, i - 1, j - 1);
+      SUM_AT(antiSums, i, j) = row[i] + SUM_AT(antiSums, i + 1, j - 1);
+    }
+  }
+
+// Cells from (i1, j1) down-right to (i2, j2), and from (i1, j1) down-left to
+// (i2, j2).
+#define MAIN_SEGMENT(i1, j1, i2, j2)                                           \
+  (SUM_AT(mainSums, i2, j2) - SUM_AT(mainSums, (i1) - 1, (j1) - 1))
+#define ANTI_SEGMENT(i1, j1, i2, j2)                                           \
+  (SUM_AT(antiSums, i2, j2) - SUM_AT(antiSums, (i1) + 1, (j1) - 1))
+
+  for (int y = 0; y < height; y++) {
+    int cy = y + range;
+
+    // The first diamond of a row is counted directly, and each following one
+    // adds its right edge and drops the previous diamond's left edge.
+    int32_t count = 0;
+    for (int dy = -range; dy <= range; dy++) {
+      int halfWidth = range - abs(dy);
+      const uint8_t *row = &extended[(size_t)(cy + dy) * extendedWidth];
+      for (int i = range - halfWidth; i <= range + halfWidth; i++)
+        count += row[i];
+    }
+    counts[(size_t)y * width] = (uint16_t)count;
+
+    for (int x = 1; x < width; x++) {
+      int left = x - 1, right = x + 2 * range; // Tips of the two edges
+      int cx = x + range;
+
+      int32_t leftEdge = ANTI_SEGMENT(cx - 1, cy - range, left, cy) +
+                         MAIN_SEGMENT(left, cy, cx - 1, cy + range) -
+                         extended[(size_t)cy * extendedWidth + left];
+      int32_t rightEdge = MAIN_SEGMENT(cx, cy - range, right, cy) +
+                          ANTI_SEGMENT(right, cy, cx, cy + range) -
+                          extended[(size_t)cy * extendedWidth + right];
+      count += rightEdge - leftEdge;
+      counts[(size_t)y * width + x] = (uint16_t)count;
+    }
+  }
+
+#undef MAIN_SEGMENT
+#undef ANTI_SEGMENT
+}
+
+// Hexagonal cells are stored as rows sheared by half a cell each, so the six
+// neighbors are the Moore ones without the top right and bottom left cells.
+static void countHexagonalNeighbors(RangeCounter *counter, uint16_t *counts) {
+  int width = counter->width, height = counter->height;
+  int extendedWidth = width + 2;
+
+  for (int y = 0; y < height; y++) {
+    const uint8_t *above = &counter->extended[(size_t)y * extendedWidth + 1];
+    const uint8_t *row = above + extendedWidth;
+    const uint8_t *below = row + extendedWidth;
+    uint16_t *rowCounts = &counts[(size_t)y * width];
+    for (int x = 0; x < width; x++) {
+      rowCounts[x] = above[x - 1] + above[x] + row[x - 1] + row[x] +
+                     row[x + 1] + below[x] + below[x + 1];
+    }
+  }
+}
+
+// Triangles alternate between pointing up and down along a row, with the cell
+// at (0, 0) pointing up. A triangle touches 5 cells in the row along its base,
+// 4 in its own row, and 3 in the row at its tip.
+static void countTriangularNeighbors(RangeCounter *counter, uint16_t *counts) {
+  int width = counter->width, height = counter->height;
+  int extendedWidth = width + 4;
+
+  for (int y = 0; y < height; y++) {
+    const uint8_t *above =
+        &counter->extended[(size_t)(y + 1) * extendedWidth + 2];
+    const uint8_t *row = above + extendedWidth;
+    const uint8_t *below = row + extendedWidth;
+    uint16_t *rowCounts = &counts[(size_t)y * width];
+    for (int x = 0; x < width; x++) {
+      bool pointsUp = ((x + y) & 1) == 0;
+      const uint8_t *base = pointsUp ? below : above;
+      const uint8_t *tip = pointsUp ? above : below;
+      rowCounts[x] = base[x - 2] + base[x - 1] + base[x] + base[x + 1] +
+                     base[x + 2] + row[x - 2] + row[x - 1] + row[x] +
+                     row[x + 1] + row[x + 2] + tip[x - 1] + tip[x] + tip[x + 1];
+    }
+  }
+}
+
+void countRangeNeighbors(RangeCounter *counter, const Rule *rule,
+                         const uint8_t *cells, ptrdiff_t stride,
+                         uint16_t *counts) {
+  fillExtendedPlane(counter, cells, stride);
+
+  switch (rule->neighborhood) {
+  case NEIGHBORHOOD_MOORE:
+    countMooreNeighbors(counter, counts);
+    break;
+  case NEIGHBORHOOD_VON_NEUMANN:
+    countVonNeumannNeighbors(counter, counts);
+    break;
+  case NEIGHBORHOOD_HEXAGONAL:
+    countHexagonalNeighbors(counter, counts);
+    break;
+  case NEIGHBORHOOD_TRIANGULAR:
+    countTriangularNeighbors(counter, counts);
+    break;
+  }
+
+  // All counts above include the middle cell.
+  if (!rule->includesMiddle) {
+    for (int y = 0; y < counter->height; y++) {
+      const uint8_t *row = &cells[y * stride];
+      uint16_t *rowCounts = &counts[(size_t)y * counter->width];
+      for (int x = 0; x < counter->width; x++)
+        rowCounts[x] -= row[x] == 1;
+    }
+  }
+}
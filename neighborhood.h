@@ -0,0 +1,38 @@
+#ifndef GOL_NEIGHBORHOOD_H
+#define GOL_NEIGHBORHOOD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rule.h"
+
+// Counts every neighborhood other than the standard 8 cell one. The board is
+// copied into a packed plane of live flags with a wrapped border, from which
+// - range-R Moore neighborhoods are read as four corners of a summed-area
+//   table, and von Neumann diamonds are slid along each row using running
+//   sums along both diagonals, both in O(1) per cell independent of R.
+// - hexagonal and triangular neighborhoods are summed from fixed offsets into
+//   the neighboring rows.
+typedef struct {
+  int width, height; // Board size
+  int border;        // Wrapped border around the extended plane
+  int stride;        // Row length of the padded sum planes
+  uint8_t *extended; // (width + 2B) x (height + 2B) live flags
+  int32_t *sums;     // Summed-area table, or main diagonal running sums
+  int32_t *antiSums; // Anti-diagonal running sums, von Neumann only
+} RangeCounter;
+
+bool initRangeCounter(RangeCounter *counter, int width, int height,
+                      const Rule *rule);
+void freeRangeCounter(RangeCounter *counter);
+
+// Fills `counts` with the number of live cells (state 1) in each cell's
+// neighborhood. `cells` points at cell (0, 0) of a plane of states whose rows
+// are `stride` bytes apart, and `counts` is a row-major width x height plane.
+// The board wraps at the edges.
+void countRangeNeighbors(RangeCounter *counter, const Rule *rule,
+                         const uint8_t *cells, ptrdiff_t stride,
+                         uint16_t *counts);
+
+#endif // GOL_NEIGHBORHOOD_H
@@ -0,0 +1,103 @@
+#include "profiler.h"
+
+#include "trace.h"
+
+#define OVERLAY_COLUMNS 34
+#define OVERLAY_LINE_HEIGHT (SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE + 2)
+#define OVERLAY_PADDING 6
+
+static const char *phaseNames[PHASE_COUNT] = {
+    [PHASE_FRAME] = "frame",
+    [PHASE_TICK] = "tick",
+    [PHASE_SIMULATE] = "simulate",
+    [PHASE_DRAW_MAP] = "draw map",
+    [PHASE_DRAW_CELLS] = "draw cells",
+    [PHASE_PRESENT] = "present",
+};
+
+const char *getPhaseName(ProfilePhase phase) {
+  return phaseNames[phase];
+}
+
+void endProfiledPhase(Profiler *profiler, ProfilePhase phase, uint64_t start) {
+  uint64_t end = SDL_GetPerformanceCounter();
+  addPhaseTime(profiler, phase, end - start);
+  addTraceSpan(phaseNames[phase], start, end);
+}
+
+void startProfiledFrame(Profiler *profiler, uint64_t generation) {
+  uint64_t now = SDL_GetPerformanceCounter();
+  if (profiler->lastFrameStart)
+    addPhaseTime(profiler, PHASE_FRAME, now - profiler->lastFrameStart);
+  profiler->lastFrameStart = now;
+
+  // Rewinds and resets count as no progress rather than negative.
+  uint64_t elapsed = now - profiler->rateStart;
+  if (!profiler->rateStart || elapsed >= SDL_GetPerformanceFrequency()) {
+    if (profiler->rateStart) {
+      uint64_t steps = generation > profiler->rateGeneration
+                           ? generation - profiler->rateGeneration
+                           : 0;
+      profiler->generationsPerSecond =
+          steps * (double)SDL_GetPerformanceFrequency() / elapsed;
+    }
+    profiler->rateStart = now;
+    profiler->rateGeneration = generation;
+  }
+}
+
+static int compareTicks(const void *a, const void *b) {
+  uint64_t first = *(const uint64_t *)a, second = *(const uint64_t *)b;
+  return first < second ? -1 : first > second;
+}
+
+void getPhasePercentiles(const Profiler *profiler, ProfilePhase phase,
+                         double milliseconds[3]) {
+  static const int percentiles[3] = {50, 95, 99};
+  const PhaseTimes *times = &profiler->phases[phase];
+  if (!times->count) {
+    milliseconds[0] = milliseconds[1] = milliseconds[2] = 0;
+    return;
+  }
+
+  uint64_t sorted[PROFILER_SAMPLES];
+  SDL_memcpy(sorted, times->samples, times->count * sizeof(uint64_t));
+  SDL_qsort(sorted, times->count, sizeof(uint64_t), compareTicks);
+  double ticksPerMillisecond = SDL_GetPerformanceFrequency() / 1000.0;
+  for (int i = 0; i < 3; i++) {
+    int index = (times->count - 1) * percentiles[i] / 100;
+    milliseconds[i] = sorted[index] / ticksPerMillisecond;
+  }
+}
+
+void drawProfilerOverlay(const Profiler *profiler, SDL_Renderer *renderer,
+                         float x, float y, int population) {
+  SDL_FRect background = {
+      x,
+      y,
+      OVERLAY_COLUMNS * SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE +
+          2 * OVERLAY_PADDING,
+      (PHASE_COUNT + 3) * OVERLAY_LINE_HEIGHT + 2 * OVERLAY_PADDING,
+  };
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+  SDL_RenderFillRect(renderer, &background);
+
+  SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
+  x += OVERLAY_PADDING;
+  y += OVERLAY_PADDING;
+  SDL_RenderDebugTextFormat(renderer, x, y, "%.1f gen/s",
+                            profiler->generationsPerSecond);
+  y += OVERLAY_LINE_HEIGHT;
+  SDL_RenderDebugTextFormat(renderer, x, y, "population %d", population);
+  y += OVERLAY_LINE_HEIGHT;
+  SDL_RenderDebugTextFormat(renderer, x, y, "%-10s %7s %7s %7s", "ms", "p50",
+                            "p95", "p99");
+  for (int phase = 0; phase < PHASE_COUNT; phase++) {
+    double milliseconds[3];
+    getPhasePercentiles(profiler, phase, milliseconds);
+    y += OVERLAY_LINE_HEIGHT;
+    SDL_RenderDebugTextFormat(renderer, x, y, "%-10s %7.2f %7.2f %7.2f",
+                              phaseNames[phase], milliseconds[0],
+                              milliseconds[1], milliseconds[2]);
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef GOL_PROFILER_H
+#define GOL_PROFILER_H
+
+#include <SDL3/SDL.h>
+
+#define PROFILER_SAMPLES 256 // Rolling window of each phase
+
+// Parts of a frame that are timed.
+typedef enum {
+  PHASE_FRAME, // From one frame to the next
+  PHASE_TICK,
+  PHASE_SIMULATE,
+  PHASE_DRAW_MAP,
+  PHASE_DRAW_CELLS,
+  PHASE_PRESENT,
+  PHASE_COUNT,
+} ProfilePhase;
+
+// The latest durations of a phase, in performance counter ticks.
+typedef struct {
+  uint64_t samples[PROFILER_SAMPLES];
+  int next, count;
+} PhaseTimes;
+
+typedef struct {
+  PhaseTimes phases[PHASE_COUNT];
+  uint64_t lastFrameStart;
+
+  // Generations per second, measured over about a second
+  uint64_t rateStart, rateGeneration;
+  double generationsPerSecond;
+} Profiler;
+
+static inline void addPhaseTime(Profiler *profiler, ProfilePhase phase,
+                                uint64_t ticks) {
+  PhaseTimes *times = &profiler->phases[phase];
+  times->samples[times->next] = ticks;
+  times->next = (times->next + 1) % PROFILER_SAMPLES;
+  if (times->count < PROFILER_SAMPLES)
+    times->count++;
+}
+
+// Returns a short name of a phase, such as "draw map".
+const char *getPhaseName(ProfilePhase phase);
+
+// Adds a run of a phase that started at `start`, and traces it as a span.
+void endProfiledPhase(Profiler *profiler, ProfilePhase phase, uint64_t start);
+
+// Times the statement or block that follows as one run of a phase. Builds
+// without GOL_PROFILE run it once, untimed, which compiles to nothing extra.
+#ifdef GOL_PROFILE
+#define WITH_PROFILED_PHASE(profiler, phase)                                   \
+  for (uint64_t phaseStart = SDL_GetPerformanceCounter(), flag = 0;            \
+       flag != 1; endProfiledPhase((profiler), (phase), phaseStart), flag = 1)
+#else
+#define WITH_PROFILED_PHASE(profiler, phase)                                   \
+  for (bool flag = ((void)(profiler), false); !flag; flag = true)
+#endif
+
+// Marks the start of a frame, timing the one before, and updates the
+// generation rate.
+void startProfiledFrame(Profiler *profiler, uint64_t generation);
+
+// Writes the 50th, 95th and 99th percentile of a phase's durations in
+// milliseconds, or zeros before the first sample.
+void getPhasePercentiles(const Profiler *profiler, ProfilePhase phase,
+                         double milliseconds[3]);
+
+// Draws the generation rate, population and phase percentiles as debug text
+// with the top left corner at (x, y).
+void drawProfilerOverlay(const Profiler *profiler, SDL_Renderer *renderer,
+                         float x, float y, int population);
+
+#endif // GOL_PROFILER_H
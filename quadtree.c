@@ -0,0 +1,172 @@
+#include "quadtree.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_NODE_CAPACITY 1024
+
+static uint32_t hashNode(int level, const uint32_t children[4]) {
+  uint64_t hash = (uint64_t)level;
+  for (int i = 0; i < 4; i++)
+    hash = (hash ^ children[i]) * 0x9E3779B97F4A7C15ull;
+  return (uint32_t)(hash >> 32);
+}
+
+bool initNodeTable(NodeTable *table) {
+  *table = (NodeTable){
+      .nodeCount = 1, // Index 0 is QUAD_EMPTY and never stored
+      .nodeCapacity = INITIAL_NODE_CAPACITY,
+      .bucketCount = INITIAL_NODE_CAPACITY,
+  };
+  table->nodes = calloc(table->nodeCapacity, sizeof(QuadNode));
+  table->buckets = calloc(table->bucketCount, sizeof(uint32_t));
+  if (!table->nodes || !table->buckets) {
+    freeNodeTable(table);
+    return false;
+  }
+  return true;
+}
+
+void freeNodeTable(NodeTable *table) {
+  free(table->nodes);
+  free(table->buckets);
+  *table = (NodeTable){0};
+}
+
+// Doubles the node storage and the buckets, keeping about one node per
+// bucket.
+static bool growNodeTable(NodeTable *table) {
+  if (table->nodeCapacity > UINT32_MAX / 2)
+    return false;
+
+  uint32_t capacity = table->nodeCapacity * 2;
+  QuadNode *nodes = realloc(table->nodes, capacity * sizeof(QuadNode));
+  if (!nodes)
+    return false;
+  table->nodes = nodes;
+  table->nodeCapacity = capacity;
+
+  uint32_t *buckets = calloc(capacity, sizeof(uint32_t));
+  if (!buckets)
+    return false;
+  free(table->buckets);
+  table->buckets = buckets;
+  table->bucketCount = capacity;
+  for (uint32_t i = 1; i < table->nodeCount; i++) {
+    QuadNode *node = &table->nodes[i];
+    uint32_t bucket = hashNode(node->level, node->children) % capacity;
+    node->next = buckets[bucket];
+    buckets[bucket] = i;
+  }
+  return true;
+}
+
+uint32_t findNode(NodeTable *table, int level, const uint32_t children[4]) {
+  if (!children[0] && !children[1] && !children[2] && !children[3])
+    return QUAD_EMPTY;
+
+  uint32_t hash = hashNode(level, children);
+  for (uint32_t i = table->buckets[hash % table->bucketCount]; i;
+       i = table->nodes[i].next) {
+    const QuadNode *node = &table->nodes[i];
+    if (node->level == level &&
+        memcmp(node->children, children, sizeof(node->children)) == 0)
+      return i;
+  }
+
+  if (table->nodeCount == table->nodeCapacity && !growNodeTable(table))
+    return QUAD_INVALID;
+
+  uint32_t index = table->nodeCount++;
+  uint32_t bucket = hash % table->bucketCount;
+  QuadNode *node = &table->nodes[index];
+  memcpy(node->children, children, sizeof(node->children));
+  node->level = (uint8_t)level;
+  node->next = table->buckets[bucket];
+  table->buckets[bucket] = index;
+  return index;
+}
+
+uint8_t getNodeCell(const NodeTable *table, uint32_t node, int level,
+                    int64_t x, int64_t y) {
+  for (; level > 0 && node != QUAD_EMPTY; level--) {
+    int64_t half = (int64_t)1 << (level - 1);
+    int quadrant = (x >= half) + 2 * (y >= half);
+    node = table->nodes[node].children[quadrant];
+    x &= half - 1;
+    y &= half - 1;
+  }
+  // Level 1 children are the cell states themselves.
+  return (uint8_t)node;
+}
+
+int getBoardNodeLevel(const Board *board, int minLevel) {
+  // The board center sits on the node center, so the node needs to reach
+  // half the board in every direction, rounding up.
+  int level = minLevel;
+  while (((int64_t)1 << (level - 1)) < board->width - board->width / 2 ||
+         ((int64_t)1 << (level - 1)) < board->height - board->height / 2)
+    level++;
+  return level;
+}
+
+// Builds the node whose top left cell is board cell (x, y).
+static uint32_t buildBoardSubnode(NodeTable *table, const Board *board,
+                                  int level, int64_t x, int64_t y) {
+  int64_t size = (int64_t)1 << level;
+  if (x >= board->width || y >= board->height || x + size <= 0 ||
+      y + size <= 0)
+    return QUAD_EMPTY;
+
+  uint32_t children[4];
+  int64_t half = size / 2;
+  for (int i = 0; i < 4; i++) {
+    int64_t childX = x + (i & 1) * half, childY = y + (i >> 1) * half;
+    if (level == 1) {
+      bool onBoard = childX >= 0 && childX < board->width && childY >= 0 &&
+                     childY < board->height;
+      children[i] =
+          onBoard ? *getBoardCell(board, (int)childX, (int)childY) : 0;
+    } else {
+      children[i] = buildBoardSubnode(table, board, level - 1, childX, childY);
+      if (children[i] == QUAD_INVALID)
+        return QUAD_INVALID;
+    }
+  }
+  return findNode(table, level, children);
+}
+
+uint32_t buildBoardNode(NodeTable *table, const Board *board, int level) {
+  int64_t half = (int64_t)1 << (level - 1);
+  return buildBoardSubnode(table, board, level, board->width / 2 - half,
+                           board->height / 2 - half);
+}
+
+// Draws the node whose top left cell is board cell (x, y).
+static void drawSubnode(const NodeTable *table, uint32_t node, int level,
+                        int64_t x, int64_t y, Board *board) {
+  int64_t size = (int64_t)1 << level;
+  if (node == QUAD_EMPTY || x >= board->width || y >= board->height ||
+      x + size <= 0 || y + size <= 0)
+    return;
+
+  const uint32_t *children = table->nodes[node].children;
+  int64_t half = size / 2;
+  for (int i = 0; i < 4; i++) {
+    int64_t childX = x + (i & 1) * half, childY = y + (i >> 1) * half;
+    if (level > 1) {
+      drawSubnode(table, children[i], level - 1, childX, childY, board);
+    } else if (childX >= 0 && childX < board->width && childY >= 0 &&
+               childY < board->height) {
+      setBoardCell(board, (int)childX, (int)childY, (uint8_t)children[i]);
+    }
+  }
+}
+
+void drawNodeOnBoard(const NodeTable *table, uint32_t node, int level,
+                     Board *board) {
+  clearBoard(board);
+  int64_t half = (int64_t)1 << (level - 1);
+  drawSubnode(table, node, level, board->width / 2 - half,
+              board->height / 2 - half, board);
+}
@@ -0,0 +1,55 @@
+#ifndef GOL_QUADTREE_H
+#define GOL_QUADTREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+
+#define QUAD_EMPTY 0            // The all dead node, at every level
+#define QUAD_INVALID UINT32_MAX // Returned when the table can't grow
+#define QUAD_MAX_LEVEL 62       // Coordinates stay within int64_t
+
+// A square of 2^level x 2^level cells split into four quadrants. Level 1
+// nodes hold four cell states, higher levels four nodes one level down.
+typedef struct {
+  uint32_t children[4]; // Northwest, northeast, southwest, southeast
+  uint32_t next;        // Next node in the same hash bucket, 0 at the end
+  uint8_t level;
+} QuadNode;
+
+// Hash-consed quadtree nodes: every distinct node is stored exactly once, so
+// regular patterns take memory in proportion to their distinct nodes rather
+// than their cells. Nodes are referred to by index, and index 0 is
+// QUAD_EMPTY.
+typedef struct {
+  QuadNode *nodes;
+  uint32_t nodeCount, nodeCapacity;
+  uint32_t *buckets; // First node of each hash bucket, 0 when none
+  uint32_t bucketCount;
+} NodeTable;
+
+bool initNodeTable(NodeTable *table);
+void freeNodeTable(NodeTable *table);
+
+// Returns the node with these children, adding it if it is new.
+uint32_t findNode(NodeTable *table, int level, const uint32_t children[4]);
+
+// Reads the state of cell (x, y) of a node.
+uint8_t getNodeCell(const NodeTable *table, uint32_t node, int level,
+                    int64_t x, int64_t y);
+
+// Smallest level of at least `minLevel` whose nodes cover the board.
+int getBoardNodeLevel(const Board *board, int minLevel);
+
+// Builds the node of the given level centered on the board center, with dead
+// cells beyond the edges.
+uint32_t buildBoardNode(NodeTable *table, const Board *board, int level);
+
+// Clears the board and draws the part of a node centered on the board center
+// that falls within it, skipping empty quadrants.
+void drawNodeOnBoard(const NodeTable *table, uint32_t node, int level,
+                     Board *board);
+
+#endif // GOL_QUADTREE_H
@@ -0,0 +1,254 @@
+#include "recorder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+#define RECORDER_PATH_MAX 4096
+
+static size_t getCellCount(const Recorder *recorder) {
+  return (size_t)recorder->style.width * recorder->style.height;
+}
+
+// Writes an encoded frame, to the stream or to its own numbered file:
+// "run.png" becomes "run-00000042.png" for generation 42.
+static bool writeFrame(Recorder *recorder, uint64_t generation,
+                       const uint8_t *data, size_t size) {
+  if (recorder->stream)
+    return fwrite(data, 1, size, recorder->stream) == size;
+
+  const char *extension = strrchr(recorder->path, '.');
+  char path[RECORDER_PATH_MAX];
+  int length = snprintf(path, sizeof(path), "%.*s-%08llu%s",
+                        (int)(extension - recorder->path), recorder->path,
+                        (unsigned long long)generation, extension);
+  if (length < 0 || (size_t)length >= sizeof(path))
+    return false;
+
+  FILE *file = fopen(path, "wb");
+  if (!file)
+    return false;
+  bool written = fwrite(data, 1, size, file) == size;
+  return fclose(file) == 0 && written;
+}
+
+typedef struct {
+  Recorder *recorder;
+  FrameEncoder encoder;
+} EncoderThread;
+
+static int runFrameEncoder(void *data) {
+  EncoderThread *thread = data;
+  Recorder *recorder = thread->recorder;
+  nameTraceThread("recorder");
+  SDL_LockMutex(recorder->mutex);
+  for (;;) {
+    while (recorder->queueCount == 0 && !recorder->isQuitting)
+      SDL_WaitCondition(recorder->frameQueued, recorder->mutex);
+    if (recorder->queueCount == 0)
+      break;
+
+    int slot = recorder->queue[recorder->queueStart];
+    recorder->queueStart = (recorder->queueStart + 1) % RECORDER_QUEUE_FRAMES;
+    recorder->queueCount--;
+    uint64_t generation = recorder->slotGenerations[slot];
+    SDL_UnlockMutex(recorder->mutex);
+
+    const uint8_t *cells = recorder->slotCells + slot * getCellCount(recorder);
+    size_t size;
+    WITH_TRACED_SPAN("encode frame") {
+      size = encodeFrame(&thread->encoder, cells);
+    }
+
+    // The slot is free again once encoded, before the slow part.
+    SDL_LockMutex(recorder->mutex);
+    recorder->freeSlots[recorder->freeCount++] = slot;
+    SDL_BroadcastCondition(recorder->frameDone);
+    SDL_UnlockMutex(recorder->mutex);
+
+    bool written;
+    WITH_TRACED_SPAN("write frame") {
+      written = writeFrame(recorder, generation, thread->encoder.out, size);
+    }
+    if (!written)
+      SDL_Log("Couldn't write frame of generation %llu",
+              (unsigned long long)generation);
+
+    SDL_LockMutex(recorder->mutex);
+    if (written)
+      recorder->writtenFrames++;
+  }
+  SDL_UnlockMutex(recorder->mutex);
+
+  freeFrameEncoder(&thread->encoder);
+  free(thread);
+  return 0;
+}
+
+static void destroyRecorder(Recorder *recorder) {
+  if (recorder->frameDone)
+    SDL_DestroyCondition(recorder->frameDone);
+  if (recorder->frameQueued)
+    SDL_DestroyCondition(recorder->frameQueued);
+  if (recorder->mutex)
+    SDL_DestroyMutex(recorder->mutex);
+  if (recorder->stream && recorder->stream != stdout)
+    fclose(recorder->stream);
+  free(recorder->slotCells);
+  *recorder = (Recorder){0};
+}
+
+static bool getFrameFormat(const char *path, FrameFormat *format) {
+  const char *extension = strrchr(path, '.');
+  if (SDL_strcmp(path, "-") == 0 ||
+      (extension && SDL_strcasecmp(extension, ".y4m") == 0))
+    *format = FRAME_Y4M;
+  else if (extension && SDL_strcasecmp(extension, ".png") == 0)
+    *format = FRAME_PNG;
+  else if (extension && SDL_strcasecmp(extension, ".ppm") == 0)
+    *format = FRAME_PPM;
+  else
+    return false;
+  return true;
+}
+
+// Starts one encoder thread, which owns its encoder and thread data.
+static bool startEncoderThread(Recorder *recorder) {
+  EncoderThread *thread = malloc(sizeof(EncoderThread));
+  if (!thread)
+    return false;
+  thread->recorder = recorder;
+  if (!initFrameEncoder(&thread->encoder, &recorder->style,
+                        recorder->format)) {
+    free(thread);
+    return false;
+  }
+
+  SDL_Thread *handle = SDL_CreateThread(runFrameEncoder, "recorder", thread);
+  if (!handle) {
+    freeFrameEncoder(&thread->encoder);
+    free(thread);
+    return false;
+  }
+  recorder->threads[recorder->threadCount++] = handle;
+  return true;
+}
+
+bool startRecorder(Recorder *recorder, const char *path,
+                   const FrameStyle *style, uint64_t everyGenerations,
+                   RecordPolicy policy, int threadCount, int framesPerSecond) {
+  FrameFormat format;
+  if (!getFrameFormat(path, &format)) {
+    SDL_SetError("Unknown frame format: %s", path);
+    return false;
+  }
+
+  *recorder = (Recorder){
+      .path = path,
+      .format = format,
+      .style = *style,
+      .everyGenerations = everyGenerations ? everyGenerations : 1,
+      .policy = policy,
+      .freeCount = RECORDER_QUEUE_FRAMES,
+  };
+  for (int i = 0; i < RECORDER_QUEUE_FRAMES; i++)
+    recorder->freeSlots[i] = i;
+  recorder->slotCells = malloc(getCellCount(recorder) * RECORDER_QUEUE_FRAMES);
+  recorder->mutex = SDL_CreateMutex();
+  recorder->frameQueued = SDL_CreateCondition();
+  recorder->frameDone = SDL_CreateCondition();
+  if (!recorder->slotCells || !recorder->mutex || !recorder->frameQueued ||
+      !recorder->frameDone) {
+    destroyRecorder(recorder);
+    return false;
+  }
+
+  if (format == FRAME_Y4M) {
+    recorder->stream =
+        SDL_strcmp(path, "-") == 0 ? stdout : fopen(path, "wb");
+    if (!recorder->stream ||
+        !writeY4mHeader(recorder->stream, style, framesPerSecond)) {
+      SDL_SetError("Couldn't open %s", path);
+      destroyRecorder(recorder);
+      return false;
+    }
+    threadCount = 1;
+  }
+
+  if (threadCount < 1)
+    threadCount = 1;
+  if (threadCount > RECORDER_MAX_THREADS)
+    threadCount = RECORDER_MAX_THREADS;
+  for (int i = 0; i < threadCount; i++) {
+    if (!startEncoderThread(recorder)) {
+      stopRecorder(recorder);
+      return false;
+    }
+  }
+  return true;
+}
+
+void recordFrame(Recorder *recorder, const Board *board) {
+  if (!recorder->threadCount)
+    return;
+
+  // Rewinding the board restarts the count.
+  bool isDue = !recorder->hasFrame ||
+               board->generation < recorder->lastGeneration ||
+               board->generation - recorder->lastGeneration >=
+                   recorder->everyGenerations;
+  if (!isDue)
+    return;
+  recorder->hasFrame = true;
+  recorder->lastGeneration = board->generation;
+
+  SDL_LockMutex(recorder->mutex);
+  if (recorder->policy == RECORD_BLOCK && recorder->freeCount == 0) {
+    WITH_TRACED_SPAN("wait for encoders") {
+      while (recorder->freeCount == 0)
+        SDL_WaitCondition(recorder->frameDone, recorder->mutex);
+    }
+  }
+  if (recorder->freeCount == 0) {
+    recorder->droppedFrames++;
+    SDL_UnlockMutex(recorder->mutex);
+    return;
+  }
+  int slot = recorder->freeSlots[--recorder->freeCount];
+  SDL_UnlockMutex(recorder->mutex);
+
+  // The slot is ours until queued, so the copy doesn't hold the lock.
+  size_t width = recorder->style.width;
+  uint8_t *cells = recorder->slotCells + slot * getCellCount(recorder);
+  for (int y = 0; y < recorder->style.height; y++)
+    memcpy(cells + y * width, getBoardCell(board, 0, y), width);
+
+  SDL_LockMutex(recorder->mutex);
+  recorder->slotGenerations[slot] = board->generation;
+  recorder->queue[(recorder->queueStart + recorder->queueCount) %
+                  RECORDER_QUEUE_FRAMES] = slot;
+  recorder->queueCount++;
+  SDL_SignalCondition(recorder->frameQueued);
+  SDL_UnlockMutex(recorder->mutex);
+}
+
+void stopRecorder(Recorder *recorder) {
+  if (!recorder->mutex)
+    return;
+
+  SDL_LockMutex(recorder->mutex);
+  recorder->isQuitting = true;
+  SDL_BroadcastCondition(recorder->frameQueued);
+  SDL_UnlockMutex(recorder->mutex);
+  for (int i = 0; i < recorder->threadCount; i++)
+    SDL_WaitThread(recorder->threads[i], nullptr);
+
+  if (recorder->stream && fflush(recorder->stream) != 0)
+    SDL_Log("Couldn't write frames to %s", recorder->path);
+  if (recorder->threadCount)
+    SDL_Log("Recorded %llu frames, dropped %llu",
+            (unsigned long long)recorder->writtenFrames,
+            (unsigned long long)recorder->droppedFrames);
+  destroyRecorder(recorder);
+}
@@ -0,0 +1,67 @@
+#ifndef GOL_RECORDER_H
+#define GOL_RECORDER_H
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+
+#include "board.h"
+#include "frame.h"
+
+#define RECORDER_QUEUE_FRAMES 32 // Frames waiting or being encoded at most
+#define RECORDER_MAX_THREADS 16
+
+// What happens to a frame when the queue is full.
+typedef enum {
+  RECORD_DROP,  // Skip the frame, so stepping never waits
+  RECORD_BLOCK, // Wait for a free slot, so no frame is lost
+} RecordPolicy;
+
+// Encodes frames of the board every N generations on background threads.
+// Each frame is a copy of the cells taken when it's recorded, queued until a
+// thread is free to encode and write it. Image frames go to numbered files
+// and are encoded in parallel; Y4M frames go to one stream in order, so a
+// single thread encodes them.
+typedef struct {
+  const char *path; // "-" streams Y4M to stdout
+  FrameFormat format;
+  FrameStyle style;
+  uint64_t everyGenerations;
+  RecordPolicy policy;
+  FILE *stream; // Y4M output
+
+  SDL_Thread *threads[RECORDER_MAX_THREADS];
+  int threadCount;
+  SDL_Mutex *mutex;
+  SDL_Condition *frameQueued; // Signaled for the encoders
+  SDL_Condition *frameDone;   // Signaled for the stepping thread
+
+  // Each slot holds the cells of one frame. Free slots are stacked and
+  // queued ones encoded oldest first.
+  uint8_t *slotCells;
+  uint64_t slotGenerations[RECORDER_QUEUE_FRAMES];
+  int freeSlots[RECORDER_QUEUE_FRAMES];
+  int freeCount;
+  int queue[RECORDER_QUEUE_FRAMES];
+  int queueStart, queueCount;
+  bool isQuitting;
+
+  uint64_t lastGeneration; // Generation of the last frame taken
+  bool hasFrame;           // Whether any frame was taken yet
+  uint64_t writtenFrames, droppedFrames;
+} Recorder;
+
+// Picks the format from the path's extension: .ppm, .png or .y4m, or "-"
+// for Y4M on stdout. Image frames are written next to the path, numbered by
+// generation. Returns false for unknown formats or when out of resources.
+bool startRecorder(Recorder *recorder, const char *path,
+                   const FrameStyle *style, uint64_t everyGenerations,
+                   RecordPolicy policy, int threadCount, int framesPerSecond);
+
+// Queues a frame of the board if its generation is due. Call after every
+// step, load and reset.
+void recordFrame(Recorder *recorder, const Board *board);
+
+// Waits for every queued frame to be written and stops the encoders.
+void stopRecorder(Recorder *recorder);
+
+#endif // GOL_RECORDER_H
@@ -0,0 +1,370 @@
+#include "rle.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RLE_LINE_MAX 70      // Longest line written, as other programs expect
+#define RLE_HEADER_MAX 256   // Longer comment and header lines are cut off
+#define RLE_LETTER_STATES 24 // States named by a single letter, A to X
+
+// Returns the next byte without consuming it, or EOF at the end of the file.
+static inline int peekRleByte(RleReader *reader) {
+  if (reader->position == reader->length) {
+    reader->length =
+        fread(reader->buffer, 1, sizeof(reader->buffer), reader->file);
+    reader->position = 0;
+    if (reader->length == 0)
+      return EOF;
+  }
+  return reader->buffer[reader->position];
+}
+
+static inline int readRleByte(RleReader *reader) {
+  int c = peekRleByte(reader);
+  if (c != EOF)
+    reader->position++;
+  return c;
+}
+
+// Reads the rest of the current line, cutting it off if it doesn't fit.
+static void readRleLine(RleReader *reader, char *line, size_t size) {
+  size_t length = 0;
+  int c;
+  while ((c = readRleByte(reader)) != EOF && c != '\n') {
+    if (c != '\r' && length + 1 < size)
+      line[length++] = (char)c;
+  }
+  line[length] = '\0';
+}
+
+// #CXRLE Pos=-10,-5 Gen=1024
+static void parseCxrleLine(RleReader *reader, const char *line) {
+  const char *position = strstr(line, "Pos=");
+  if (position && sscanf(position, "Pos=%d,%d", &reader->positionX,
+                         &reader->positionY) == 2)
+    reader->hasPosition = true;
+
+  const char *generation = strstr(line, "Gen=");
+  if (generation)
+    reader->generation = strtoull(generation + 4, nullptr, 10);
+}
+
+// x = 3, y = 3, rule = B3/S23
+static bool parseHeaderLine(RleReader *reader, const char *line) {
+  bool hasWidth = false, hasHeight = false;
+  while (*line) {
+    while (isspace((unsigned char)*line) || *line == ',')
+      line++;
+    if (!*line)
+      break;
+
+    const char *key = line;
+    while (isalpha((unsigned char)*line))
+      line++;
+    size_t keyLength = line - key;
+    while (isspace((unsigned char)*line))
+      line++;
+    if (keyLength == 0 || *line != '=')
+      return false;
+    line++;
+    while (isspace((unsigned char)*line))
+      line++;
+
+    if (keyLength == 4 && strncmp(key, "rule", 4) == 0) {
+      // The rule runs to the end of the line, since Larger than Life rules
+      // contain commas. Bounded grid suffixes such as ":T40,40" are dropped.
+      size_t length = strcspn(line, ":");
+      while (length > 0 && isspace((unsigned char)line[length - 1]))
+        length--;
+      if (length >= sizeof(reader->rule))
+        return false;
+      memcpy(reader->rule, line, length);
+      reader->rule[length] = '\0';
+      break;
+    }
+
+    char *end;
+    long value = strtol(line, &end, 10);
+    if (end == line || value < 0 || value > INT_MAX)
+      return false;
+    if (keyLength == 1 && *key == 'x') {
+      reader->width = (int)value;
+      hasWidth = true;
+    } else if (keyLength == 1 && *key == 'y') {
+      reader->height = (int)value;
+      hasHeight = true;
+    }
+    line = end;
+  }
+
+  return hasWidth && hasHeight;
+}
+
+bool openRleReader(RleReader *reader, FILE *file) {
+  reader->file = file;
+  reader->length = reader->position = 0;
+  reader->width = reader->height = 0;
+  reader->hasPosition = false;
+  reader->positionX = reader->positionY = 0;
+  reader->generation = 0;
+  reader->rule[0] = '\0';
+
+  char line[RLE_HEADER_MAX];
+  for (;;) {
+    int c = peekRleByte(reader);
+    if (c == EOF) {
+      return false;
+    } else if (c == '#') {
+      readRleLine(reader, line, sizeof(line));
+      if (strncmp(line, "#CXRLE", 6) == 0)
+        parseCxrleLine(reader, line);
+    } else if (isspace(c)) {
+      readRleByte(reader);
+    } else {
+      readRleLine(reader, line, sizeof(line));
+      return parseHeaderLine(reader, line);
+    }
+  }
+}
+
+// Sets `count` cells of row y from x on, dropping those off the board.
+static void placeRun(Board *board, int64_t x, int64_t y, int64_t count,
+                     uint8_t state) {
+  if (y < 0 || y >= board->height)
+    return;
+
+  int64_t first = x < 0 ? 0 : x;
+  int64_t last = x + count < board->width ? x + count : board->width;
+  if (first < last)
+    memset(getBoardCell(board, (int)first, (int)y), state, last - first);
+}
+
+// Maps a state letter, and the p to y before it if any, to a state.
+static inline int getLetterState(int prefix, int letter) {
+  int state = letter - 'A' + 1;
+  if (prefix)
+    state += (prefix - 'p' + 1) * RLE_LETTER_STATES;
+  return state;
+}
+
+static bool placeRleCells(RleReader *reader, Board *board) {
+  clearBoard(board);
+  board->generation = reader->generation;
+
+  int64_t left = reader->hasPosition
+                     ? board->width / 2 + (int64_t)reader->positionX
+                     : ((int64_t)board->width - reader->width) / 2;
+  int64_t top = reader->hasPosition
+                    ? board->height / 2 + (int64_t)reader->positionY
+                    : ((int64_t)board->height - reader->height) / 2;
+  int64_t x = left, y = top;
+  int64_t count = 0;     // Pending run count, 0 when none was given
+  int prefix = 0;        // Pending p to y of a two letter state, 0 when none
+  int64_t prefixRun = 1; // Run length given before the prefix
+  int maxState = board->rule.numStates - 1; // Higher states are read as alive
+
+  while (peekRleByte(reader) != EOF) {
+    // The cursor is kept in locals so that writing cells doesn't force it
+    // back into the reader for every byte.
+    const unsigned char *next = reader->buffer + reader->position;
+    const unsigned char *end = reader->buffer + reader->length;
+    reader->position = reader->length;
+
+    while (next < end) {
+      int c = *next++;
+      if (c >= '0' && c <= '9') {
+        count = count * 10 + (c - '0');
+        if (count > INT_MAX)
+          return false;
+        continue;
+      }
+      if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+        continue;
+
+      int64_t run = count ? count : 1;
+      count = 0;
+      if (prefix) {
+        if (c >= 'A' && c <= 'X') {
+          int state = getLetterState(prefix, c);
+          placeRun(board, x, y, prefixRun, state > maxState ? 1 : state);
+          x += prefixRun;
+          prefix = 0;
+          continue;
+        }
+
+        // Without a letter after it, p to y is an alive cell like any other
+        // lower case letter.
+        placeRun(board, x, y, prefixRun, 1);
+        x += prefixRun;
+        prefix = 0;
+      }
+
+      int state;
+      switch (c) {
+      case '!':
+        reader->position = next - reader->buffer;
+        return true;
+      case '$':
+        x = left;
+        y += run;
+        continue;
+      case 'b':
+      case '.':
+        x += run;
+        continue;
+      default:
+        if (c >= 'A' && c <= 'X') {
+          state = getLetterState(0, c);
+        } else if (c >= 'p' && c <= 'y') {
+          prefix = c;
+          prefixRun = run;
+          continue;
+        } else if (c >= 'a' && c <= 'z') {
+          state = 1; // Any other letter is alive in two-state patterns
+        } else {
+          return false;
+        }
+        break;
+      }
+
+      placeRun(board, x, y, run, (uint8_t)(state > maxState ? 1 : state));
+      x += run;
+    }
+  }
+
+  return !ferror(reader->file);
+}
+
+bool readRleCells(RleReader *reader, Board *board) {
+  // Runs are written in bulk, without updating the hash.
+  bool isRead = placeRleCells(reader, board);
+  rehashBoard(board);
+  return isRead;
+}
+
+// Collects runs into lines and writes them out in large blocks.
+typedef struct {
+  FILE *file;
+  char buffer[RLE_BUFFER_SIZE];
+  size_t length;
+  int lineLength;
+} RleWriter;
+
+static void flushRleWriter(RleWriter *writer) {
+  fwrite(writer->buffer, 1, writer->length, writer->file);
+  writer->length = 0;
+}
+
+// Appends "<count><symbol>", first breaking the line if it would get too long.
+static void writeRun(RleWriter *writer, int count, const char *symbol) {
+  char token[16];
+  int length = 0;
+  if (count > 1) {
+    char digits[10]; // Least significant first
+    int digitCount = 0;
+    for (; count > 0; count /= 10)
+      digits[digitCount++] = (char)('0' + count % 10);
+    while (digitCount > 0)
+      token[length++] = digits[--digitCount];
+  }
+  while (*symbol)
+    token[length++] = *symbol++;
+
+  // Room for a line break before the token, and for the newline after the
+  // final !.
+  if (writer->length + length + 2 > sizeof(writer->buffer))
+    flushRleWriter(writer);
+  if (writer->lineLength + length > RLE_LINE_MAX) {
+    writer->buffer[writer->length++] = '\n';
+    writer->lineLength = 0;
+  }
+  memcpy(writer->buffer + writer->length, token, length);
+  writer->length += length;
+  writer->lineLength += length;
+}
+
+// Two-state patterns use b and o, others . and A to X, then pA to yO.
+static void getStateSymbol(uint8_t state, int numStates, char symbol[3]) {
+  if (numStates == 2) {
+    symbol[0] = state ? 'o' : 'b';
+    symbol[1] = '\0';
+  } else if (state == 0) {
+    symbol[0] = '.';
+    symbol[1] = '\0';
+  } else if (state <= RLE_LETTER_STATES) {
+    symbol[0] = (char)('A' + state - 1);
+    symbol[1] = '\0';
+  } else {
+    symbol[0] = (char)('p' + (state - 1) / RLE_LETTER_STATES - 1);
+    symbol[1] = (char)('A' + (state - 1) % RLE_LETTER_STATES);
+    symbol[2] = '\0';
+  }
+}
+
+bool writeRle(FILE *file, const Board *board) {
+  int left = board->width, right = -1, top = board->height, bottom = -1;
+  for (int y = 0; y < board->height; y++) {
+    const uint8_t *row = getBoardCell(board, 0, y);
+    for (int x = 0; x < board->width; x++) {
+      if (row[x] != 0) {
+        left = x < left ? x : left;
+        right = x > right ? x : right;
+        top = y < top ? y : top;
+        bottom = y;
+      }
+    }
+  }
+  if (right < 0) {
+    // An empty pattern sits at the center.
+    left = board->width / 2;
+    top = board->height / 2;
+    right = left - 1;
+    bottom = top - 1;
+  }
+
+  char ruleName[RULE_STRING_MAX];
+  formatRule(&board->rule, ruleName, sizeof(ruleName));
+  fprintf(file, "#CXRLE Pos=%d,%d Gen=%" PRIu64 "\n", left - board->width / 2,
+          top - board->height / 2, board->generation);
+  fprintf(file, "x = %d, y = %d, rule = %s\n", right - left + 1,
+          bottom - top + 1, ruleName);
+
+  RleWriter writer;
+  writer.file = file;
+  writer.length = 0;
+  writer.lineLength = 0;
+  int pendingRows = 0; // Row ends not written yet
+  for (int y = top; y <= bottom; y++, pendingRows++) {
+    const uint8_t *row = getBoardCell(board, 0, y);
+
+    // Dead cells at the end of a row are left out.
+    int end = right + 1;
+    while (end > left && row[end - 1] == 0)
+      end--;
+    if (end == left)
+      continue;
+    if (pendingRows > 0) {
+      writeRun(&writer, pendingRows, "$");
+      pendingRows = 0;
+    }
+
+    for (int x = left; x < end;) {
+      int run = 1;
+      while (x + run < end && row[x + run] == row[x])
+        run++;
+
+      char symbol[3];
+      getStateSymbol(row[x], board->rule.numStates, symbol);
+      writeRun(&writer, run, symbol);
+      x += run;
+    }
+  }
+  writeRun(&writer, 1, "!");
+  writer.buffer[writer.length++] = '\n';
+  flushRleWriter(&writer);
+
+  return !ferror(file);
+}
@@ -0,0 +1,42 @@
+#ifndef GOL_RLE_H
+#define GOL_RLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "board.h"
+#include "rule.h"
+
+#define RLE_BUFFER_SIZE 16384
+
+// Reads a run length encoded pattern in a single pass over a fixed buffer.
+// Opening reads the comment lines and the header, which is enough to pick a
+// rule and board size, and the runs are then decoded straight into a board.
+typedef struct {
+  FILE *file;
+  unsigned char buffer[RLE_BUFFER_SIZE];
+  size_t length, position; // Filled and consumed bytes of the buffer
+
+  int width, height;          // Pattern size from the header line
+  bool hasPosition;           // Whether a #CXRLE line gave a position
+  int positionX, positionY;   // Top left cell relative to the board center
+  uint64_t generation;        // #CXRLE generation, 0 when missing
+  char rule[RULE_STRING_MAX]; // Empty when the header names no rule
+} RleReader;
+
+// Reads everything up to the first run. Returns false when the header line is
+// missing or malformed.
+bool openRleReader(RleReader *reader, FILE *file);
+
+// Decodes the runs into a cleared board and restores the generation count.
+// The pattern goes where its #CXRLE position says, or is centered, and cells
+// falling outside the board are dropped. Returns false on malformed runs.
+bool readRleCells(RleReader *reader, Board *board);
+
+// Writes the bounding box of the non-dead cells, along with the rule and the
+// generation count. Returns false when writing fails.
+bool writeRle(FILE *file, const Board *board);
+
+#endif // GOL_RLE_H
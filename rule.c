@@ -0,0 +1,322 @@
+#include "rule.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DIGIT_COUNT 9
+
+// Reads a run of neighbor counts, e.g. the "23" of "S23": single digits, or
+// counts past 9 in parentheses, e.g. "(12)". Counts are checked against the
+// neighborhood once the whole rule is parsed.
+static const char *parseCounts(const char *text, bool *counts) {
+  for (;;) {
+    if (isdigit((unsigned char)*text)) {
+      counts[*text - '0'] = true;
+      text++;
+    } else if (*text == '(' && isdigit((unsigned char)text[1])) {
+      char *end;
+      long count = strtol(text + 1, &end, 10);
+      if (*end != ')' || count <= MAX_DIGIT_COUNT ||
+          count > RULE_MAX_NEIGHBORS)
+        return nullptr;
+      counts[count] = true;
+      text = end + 1;
+    } else {
+      return text;
+    }
+  }
+}
+
+static const char *parseStateCount(const char *text, int *numStates) {
+  if (!isdigit((unsigned char)*text))
+    return nullptr;
+
+  char *end;
+  long value = strtol(text, &end, 10);
+  if (value < 2 || value > RULE_MAX_STATES)
+    return nullptr;
+
+  *numStates = (int)value;
+  return end;
+}
+
+// B3/S23, B2/S/C3, b3s23
+static bool parseBirthSurvivalNotation(const char *text, Rule *rule) {
+  bool hasBirth = false;
+  while (text && *text) {
+    switch (tolower((unsigned char)*text)) {
+    case 'b':
+      hasBirth = true;
+      text = parseCounts(text + 1, rule->birth);
+      break;
+    case 's':
+      text = parseCounts(text + 1, rule->survival);
+      break;
+    case 'c':
+    case 'g':
+      text = parseStateCount(text + 1, &rule->numStates);
+      break;
+    case '/':
+      text++;
+      break;
+    default:
+      return false;
+    }
+  }
+
+  return text && hasBirth;
+}
+
+// 23/3, /2/3, 345/2/4
+static bool parseSurvivalBirthNotation(const char *text, Rule *rule) {
+  text = parseCounts(text, rule->survival);
+  if (!text || *text != '/')
+    return false;
+
+  text = parseCounts(text + 1, rule->birth);
+  if (text && *text == '/')
+    text = parseStateCount(text + 1, &rule->numStates);
+
+  return text && *text == '\0';
+}
+
+// Reads a "min..max" interval of neighbor counts. A lone number is an
+// interval of one.
+static const char *parseCountInterval(const char *text, bool *counts) {
+  if (!isdigit((unsigned char)*text))
+    return nullptr;
+
+  char *end;
+  long min = strtol(text, &end, 10);
+  long max = min;
+  if (end[0] == '.' && end[1] == '.') {
+    if (!isdigit((unsigned char)end[2]))
+      return nullptr;
+    max = strtol(end + 2, &end, 10);
+  }
+  if (min > max || max > RULE_MAX_NEIGHBORS)
+    return nullptr;
+
+  for (long count = min; count <= max; count++)
+    counts[count] = true;
+  return end;
+}
+
+// R5,C0,M1,S34..58,B34..45,NM
+static bool parseLargerThanLifeNotation(const char *text, Rule *rule) {
+  bool *lastCounts = nullptr; // Section that bare intervals continue
+  bool hasBirth = false;
+  char *end;
+  while (text && *text) {
+    switch (toupper((unsigned char)*text)) {
+    case 'R': {
+      if (!isdigit((unsigned char)text[1]))
+        return false;
+      long range = strtol(text + 1, &end, 10);
+      if (range < 1 || range > RULE_MAX_RANGE)
+        return false;
+      rule->range = (int)range;
+      text = end;
+      lastCounts = nullptr;
+      break;
+    }
+    case 'C': {
+      // C0 and C1 are both two-state rules.
+      if (!isdigit((unsigned char)text[1]))
+        return false;
+      long numStates = strtol(text + 1, &end, 10);
+      if (numStates > RULE_MAX_STATES)
+        return false;
+      rule->numStates = numStates < 2 ? 2 : (int)numStates;
+      text = end;
+      lastCounts = nullptr;
+      break;
+    }
+    case 'M':
+      if (text[1] != '0' && text[1] != '1')
+        return false;
+      rule->includesMiddle = text[1] == '1';
+      text += 2;
+      lastCounts = nullptr;
+      break;
+    case 'S':
+      lastCounts = rule->survival;
+      text = text[1] == ',' || text[1] == '\0'
+                 ? text + 1
+                 : parseCountInterval(text + 1, lastCounts);
+      break;
+    case 'B':
+      hasBirth = true;
+      lastCounts = rule->birth;
+      text = text[1] == ',' || text[1] == '\0'
+                 ? text + 1
+                 : parseCountInterval(text + 1, lastCounts);
+      break;
+    case 'N':
+      if (toupper((unsigned char)text[1]) == 'M')
+        rule->neighborhood = NEIGHBORHOOD_MOORE;
+      else if (toupper((unsigned char)text[1]) == 'N')
+        rule->neighborhood = NEIGHBORHOOD_VON_NEUMANN;
+      else
+        return false;
+      text += 2;
+      lastCounts = nullptr;
+      break;
+    case ',':
+      text++;
+      break;
+    default:
+      text = lastCounts ? parseCountInterval(text, lastCounts) : nullptr;
+      break;
+    }
+  }
+
+  return text && hasBirth;
+}
+
+bool parseRule(const char *text, Rule *rule) {
+  Rule parsed = {
+      .numStates = 2,
+      .range = 1,
+      .neighborhood = NEIGHBORHOOD_MOORE,
+  };
+
+  bool isBirthSurvival = false;
+  for (const char *c = text; *c; c++) {
+    if (*c == 'b' || *c == 'B')
+      isBirthSurvival = true;
+  }
+
+  bool isLargerThanLife = (text[0] == 'R' || text[0] == 'r') &&
+                          isdigit((unsigned char)text[1]);
+
+  // Strip the neighborhood suffix of B/S and S/B rules.
+  char body[RULE_STRING_MAX];
+  size_t length = strlen(text);
+  if (!isLargerThanLife && length > 0 && length < sizeof(body)) {
+    memcpy(body, text, length + 1);
+    switch (toupper((unsigned char)body[length - 1])) {
+    case 'H':
+      parsed.neighborhood = NEIGHBORHOOD_HEXAGONAL;
+      body[length - 1] = '\0';
+      break;
+    case 'L':
+      parsed.neighborhood = NEIGHBORHOOD_TRIANGULAR;
+      body[length - 1] = '\0';
+      break;
+    case 'V':
+      parsed.neighborhood = NEIGHBORHOOD_VON_NEUMANN;
+      body[length - 1] = '\0';
+      break;
+    }
+    text = body;
+  }
+
+  bool ok = isLargerThanLife   ? parseLargerThanLifeNotation(text, &parsed)
+            : isBirthSurvival ? parseBirthSurvivalNotation(text, &parsed)
+                              : parseSurvivalBirthNotation(text, &parsed);
+  if (!ok)
+    return false;
+
+  for (int count = getNeighborhoodSize(&parsed) + 1;
+       count <= RULE_MAX_NEIGHBORS; count++) {
+    if (parsed.birth[count] || parsed.survival[count])
+      return false;
+  }
+
+  *rule = parsed;
+  return true;
+}
+
+// Writes the set counts as comma separated "min..max" intervals.
+static int formatCountIntervals(const bool *counts, char *buffer, size_t size) {
+  int length = 0;
+  buffer[0] = '\0';
+  for (int min = 0; min <= RULE_MAX_NEIGHBORS; min++) {
+    if (!counts[min])
+      continue;
+
+    int max = min;
+    while (max + 1 <= RULE_MAX_NEIGHBORS && counts[max + 1])
+      max++;
+
+    length += snprintf(buffer + length, size - length, "%s%d..%d",
+                       length ? "," : "", min, max);
+    if ((size_t)length >= size)
+      return (int)size - 1;
+    min = max;
+  }
+  return length;
+}
+
+// Appends a count as parseCounts reads it. Only triangular rules have counts
+// past 9.
+static int formatCount(char *counts, int length, int count) {
+  if (count <= MAX_DIGIT_COUNT) {
+    counts[length++] = (char)('0' + count);
+    return length;
+  }
+  return length + sprintf(counts + length, "(%d)", count);
+}
+
+void formatRule(const Rule *rule, char *buffer, size_t size) {
+  if (rule->range > 1 || rule->includesMiddle) {
+    char birth[RULE_STRING_MAX], survival[RULE_STRING_MAX];
+    formatCountIntervals(rule->birth, birth, sizeof(birth));
+    formatCountIntervals(rule->survival, survival, sizeof(survival));
+    snprintf(buffer, size, "R%d,C%d,M%d,S%s,B%s,N%c", rule->range,
+             rule->numStates > 2 ? rule->numStates : 0,
+             rule->includesMiddle ? 1 : 0, survival, birth,
+             rule->neighborhood == NEIGHBORHOOD_MOORE ? 'M' : 'N');
+    return;
+  }
+
+  char birth[RULE_STRING_MAX] = {0};
+  char survival[RULE_STRING_MAX] = {0};
+  int birthLength = 0, survivalLength = 0;
+  for (int i = 0; i <= getNeighborhoodSize(rule); i++) {
+    if (rule->birth[i])
+      birthLength = formatCount(birth, birthLength, i);
+    if (rule->survival[i])
+      survivalLength = formatCount(survival, survivalLength, i);
+  }
+
+  const char *suffix = "";
+  switch (rule->neighborhood) {
+  case NEIGHBORHOOD_MOORE:
+    break;
+  case NEIGHBORHOOD_VON_NEUMANN:
+    suffix = "V";
+    break;
+  case NEIGHBORHOOD_HEXAGONAL:
+    suffix = "H";
+    break;
+  case NEIGHBORHOOD_TRIANGULAR:
+    suffix = "L";
+    break;
+  }
+
+  if (rule->numStates > 2)
+    snprintf(buffer, size, "B%s/S%s/C%d%s", birth, survival, rule->numStates,
+             suffix);
+  else
+    snprintf(buffer, size, "B%s/S%s%s", birth, survival, suffix);
+}
+
+int getNeighborhoodSize(const Rule *rule) {
+  int range = rule->range;
+  int middle = rule->includesMiddle ? 1 : 0;
+  switch (rule->neighborhood) {
+  case NEIGHBORHOOD_MOORE:
+    return (2 * range + 1) * (2 * range + 1) - 1 + middle;
+  case NEIGHBORHOOD_VON_NEUMANN:
+    return 2 * range * (range + 1) + middle;
+  case NEIGHBORHOOD_HEXAGONAL:
+    return 6 + middle;
+  case NEIGHBORHOOD_TRIANGULAR:
+    return 12 + middle;
+  }
+  return 0;
+}
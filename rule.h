@@ -0,0 +1,77 @@
+#ifndef GOL_RULE_H
+#define GOL_RULE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RULE_MAX_STATES 256
+#define RULE_MAX_RANGE 10
+#define RULE_MAX_NEIGHBORS                                                     \
+  ((2 * RULE_MAX_RANGE + 1) * (2 * RULE_MAX_RANGE + 1))
+#define RULE_STRING_MAX 128
+
+typedef enum {
+  NEIGHBORHOOD_MOORE,       // The (2R + 1) x (2R + 1) square
+  NEIGHBORHOOD_VON_NEUMANN, // The diamond of cells within taxicab distance R
+  NEIGHBORHOOD_HEXAGONAL,   // The 6 cells around a hexagonal cell
+  NEIGHBORHOOD_TRIANGULAR,  // The 12 cells touching a triangular cell
+} Neighborhood;
+
+// A totalistic birth/survival rule. Cells in state 0 are dead and cells in
+// state 1 are alive; only live cells count as neighbors. Generations rules
+// have more than two states: a live cell that fails to survive moves to state
+// 2 and then ages one state per generation until it wraps back to dead.
+typedef struct {
+  bool birth[RULE_MAX_NEIGHBORS + 1];    // Neighbor counts that birth a cell
+  bool survival[RULE_MAX_NEIGHBORS + 1]; // Neighbor counts that keep it alive
+  int numStates;                         // 2 for Life-like rules
+  int range;                             // 1 for Life-like rules
+  Neighborhood neighborhood;
+  bool includesMiddle; // Whether a live cell counts itself as a neighbor
+} Rule;
+
+// Parses a rule string. Accepted forms are
+// - B/S notation: "B3/S23", or "B2/S/C3" where C (or G) gives the number of
+//   states. Case-insensitive. Counts past 9, which only triangular rules
+//   have, are written in parentheses: "B4(10)/S3(12)L".
+// - S/B notation used by Generations rule tables: "23/3", "/2/3", "345/2/4".
+//   Both B/S and S/B rules take an optional suffix picking the range 1
+//   neighborhood: H (hexagonal), L (triangular) or V (von Neumann).
+// - Larger than Life notation: "R5,C0,M1,S34..58,B34..45,NM", where N is M
+//   (Moore) or N (von Neumann) and S/B take comma separated count intervals.
+// Returns false and leaves `rule` untouched on malformed input.
+bool parseRule(const char *text, Rule *rule);
+
+// Writes the rule in B/S notation, e.g. "B3/S23", "B2/S/C3" or "B2/S34H", or
+// in Larger than Life notation for range R neighborhoods.
+void formatRule(const Rule *rule, char *buffer, size_t size);
+
+// Returns the largest possible live neighbor count under the rule.
+int getNeighborhoodSize(const Rule *rule);
+
+// Triangles alternate pointing up and down, so wrapping around only keeps
+// their neighborhoods on boards of even width and height.
+static inline bool fitsRuleLattice(const Rule *rule, int width, int height) {
+  return rule->neighborhood != NEIGHBORHOOD_TRIANGULAR ||
+         (width % 2 == 0 && height % 2 == 0);
+}
+
+// Returns true when the rule's neighborhood is the standard 8 cell one.
+static inline bool isLifeLikeNeighborhood(const Rule *rule) {
+  return rule->range == 1 && rule->neighborhood == NEIGHBORHOOD_MOORE &&
+         !rule->includesMiddle;
+}
+
+static inline uint8_t getNextCellState(const Rule *rule, uint8_t state,
+                                       int liveNeighbors) {
+  if (state == 0)
+    return rule->birth[liveNeighbors] ? 1 : 0;
+  if (state == 1 && rule->survival[liveNeighbors])
+    return 1;
+
+  // Failed survivors and dying cells age towards dead.
+  return state + 1 < rule->numStates ? state + 1 : 0;
+}
+
+#endif // GOL_RULE_H
@@ -0,0 +1,131 @@
+#include "selection.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ROTATE_TILE_SIZE 32 // Cells per side of the tiles a block turns in
+
+void freeCellBlock(CellBlock *block) {
+  free(block->cells);
+  *block = (CellBlock){0};
+}
+
+bool copyCellBlock(CellBlock *block, const Board *board, int left, int top,
+                   int width, int height) {
+  uint8_t *cells = malloc((size_t)width * height);
+  if (!cells)
+    return false;
+  for (int y = 0; y < height; y++)
+    memcpy(cells + (size_t)y * width, getBoardCell(board, left, top + y),
+           width);
+  free(block->cells);
+  *block = (CellBlock){.width = width, .height = height, .cells = cells};
+  return true;
+}
+
+bool clearBoardArea(Board *board, UndoBuffer *undo, int left, int top,
+                    int width, int height) {
+  uint8_t *dead = calloc(width, 1);
+  if (!dead)
+    return false;
+  for (int y = top; y < top + height; y++)
+    setEditedRow(undo, board, left, y, dead, width);
+  free(dead);
+  return true;
+}
+
+void stampCellBlock(const CellBlock *block, Board *board, UndoBuffer *undo,
+                    int left, int top) {
+  int x0 = left > 0 ? left : 0;
+  int y0 = top > 0 ? top : 0;
+  int x1 = left + block->width < board->width ? left + block->width
+                                              : board->width;
+  int y1 = top + block->height < board->height ? top + block->height
+                                               : board->height;
+  for (int y = y0; y < y1; y++) {
+    const uint8_t *row =
+        block->cells + (size_t)(y - top) * block->width + (x0 - left);
+    setEditedRow(undo, board, x0, y, row, x1 - x0);
+  }
+}
+
+bool rotateCellBlock(CellBlock *block, bool isClockwise) {
+  int width = block->width, height = block->height;
+  uint8_t *turned = malloc((size_t)width * height);
+  if (!turned)
+    return false;
+
+  // Cell (x, y) moves to (height - 1 - y, x) clockwise, or (y, width - 1 - x)
+  // the other way, in a block height cells wide. A tile at a time, so that
+  // the rows read and the columns written both stay in cache.
+  for (int tileY = 0; tileY < height; tileY += ROTATE_TILE_SIZE) {
+    for (int tileX = 0; tileX < width; tileX += ROTATE_TILE_SIZE) {
+      int tileBottom = tileY + ROTATE_TILE_SIZE < height
+                           ? tileY + ROTATE_TILE_SIZE
+                           : height;
+      int tileRight =
+          tileX + ROTATE_TILE_SIZE < width ? tileX + ROTATE_TILE_SIZE : width;
+      for (int y = tileY; y < tileBottom; y++) {
+        const uint8_t *row = block->cells + (size_t)y * width;
+        for (int x = tileX; x < tileRight; x++) {
+          size_t index = isClockwise
+                             ? (size_t)x * height + (height - 1 - y)
+                             : (size_t)(width - 1 - x) * height + y;
+          turned[index] = row[x];
+        }
+      }
+    }
+  }
+  free(block->cells);
+  *block = (CellBlock){.width = height, .height = width, .cells = turned};
+  return true;
+}
+
+// Reverses a run of cells, swapping words from both ends with their bytes
+// reversed, then the cells left in the middle.
+static void reverseCells(uint8_t *cells, int count) {
+  int left = 0, right = count;
+  for (; right - left >= 16; left += 8, right -= 8) {
+    uint64_t first, last;
+    memcpy(&first, cells + left, 8);
+    memcpy(&last, cells + right - 8, 8);
+    first = __builtin_bswap64(first);
+    last = __builtin_bswap64(last);
+    memcpy(cells + left, &last, 8);
+    memcpy(cells + right - 8, &first, 8);
+  }
+  for (right--; left < right; left++, right--) {
+    uint8_t cell = cells[left];
+    cells[left] = cells[right];
+    cells[right] = cell;
+  }
+}
+
+// Swaps two runs of cells a word at a time.
+static void swapCells(uint8_t *a, uint8_t *b, int count) {
+  int x = 0;
+  for (; x + 8 <= count; x += 8) {
+    uint64_t first, second;
+    memcpy(&first, a + x, 8);
+    memcpy(&second, b + x, 8);
+    memcpy(a + x, &second, 8);
+    memcpy(b + x, &first, 8);
+  }
+  for (; x < count; x++) {
+    uint8_t cell = a[x];
+    a[x] = b[x];
+    b[x] = cell;
+  }
+}
+
+void flipCellBlock(CellBlock *block, bool isVertical) {
+  int width = block->width, height = block->height;
+  if (isVertical) {
+    for (int y = 0; y < height / 2; y++)
+      swapCells(block->cells + (size_t)y * width,
+                block->cells + (size_t)(height - 1 - y) * width, width);
+  } else {
+    for (int y = 0; y < height; y++)
+      reverseCells(block->cells + (size_t)y * width, width);
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef GOL_SELECTION_H
+#define GOL_SELECTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "board.h"
+#include "undo.h"
+
+// A rectangle of cells lifted off a board, as copied, cut or pasted: a byte
+// per cell, row-major without a border. Every operation moves whole rows or
+// words of cells rather than setting cells one by one, so copying or pasting
+// a block costs about as much as a memcpy of it.
+typedef struct {
+  int width, height;
+  uint8_t *cells;
+} CellBlock;
+
+void freeCellBlock(CellBlock *block);
+
+// Copies the width x height cells at (left, top), which must lie on the
+// board, replacing the block's cells.
+bool copyCellBlock(CellBlock *block, const Board *board, int left, int top,
+                   int width, int height);
+
+// Sets the width x height cells at (left, top) to dead, recording the change
+// in the open edit.
+bool clearBoardArea(Board *board, UndoBuffer *undo, int left, int top,
+                    int width, int height);
+
+// Writes the block's cells, dead ones included, with its top left cell at
+// (left, top), recording the change in the open edit. Cells that would land
+// off the board are left out.
+void stampCellBlock(const CellBlock *block, Board *board, UndoBuffer *undo,
+                    int left, int top);
+
+// Turns the block a quarter turn, which swaps its width and height.
+bool rotateCellBlock(CellBlock *block, bool isClockwise);
+
+// Mirrors the block left to right, or top to bottom.
+void flipCellBlock(CellBlock *block, bool isVertical);
+
+#endif // GOL_SELECTION_H
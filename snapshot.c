@@ -0,0 +1,184 @@
+#include "snapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Planes start a page in, so mapping the file leaves them page-aligned.
+static size_t getPlaneOffset(void) {
+  long pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize > 0 ? (size_t)pageSize : 4096;
+}
+
+// Writes every buffer, picking up where a partial write left off.
+static bool writeAll(int fd, struct iovec *buffers, int count) {
+  while (count > 0) {
+    ssize_t written = writev(fd, buffers, count);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    for (; count > 0 && (size_t)written >= buffers->iov_len; count--) {
+      written -= buffers->iov_len;
+      buffers++;
+    }
+    if (count > 0) {
+      buffers->iov_base = (char *)buffers->iov_base + written;
+      buffers->iov_len -= written;
+    }
+  }
+  return true;
+}
+
+// Flushes the directory holding `path`, which makes a rename into it durable.
+static bool syncDirectory(const char *path) {
+  char directory[SNAPSHOT_PATH_MAX];
+  const char *slash = strrchr(path, '/');
+  if (!slash)
+    snprintf(directory, sizeof(directory), ".");
+  else
+    snprintf(directory, sizeof(directory), "%.*s", (int)(slash - path + 1),
+             path);
+
+  int fd = open(directory, O_RDONLY);
+  if (fd < 0)
+    return false;
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+bool writeSnapshot(const char *path, const Board *board) {
+  char temporaryPath[SNAPSHOT_PATH_MAX];
+  if (snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path) >=
+      (int)sizeof(temporaryPath))
+    return false;
+
+  size_t planeOffset = getPlaneOffset();
+  size_t planeSize = (size_t)board->stride * (board->height + 2);
+
+  // The header is padded up to the plane.
+  SnapshotHeader *header = calloc(1, planeOffset);
+  if (!header)
+    return false;
+  memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  header->version = SNAPSHOT_VERSION;
+  header->byteOrder = SNAPSHOT_BYTE_ORDER;
+  header->planeOffset = planeOffset;
+  header->planeSize = planeSize;
+  header->width = board->width;
+  header->height = board->height;
+  header->stride = board->stride;
+  header->topology = SNAPSHOT_TOPOLOGY_TORUS;
+  header->generation = board->generation;
+  header->hash = board->hash;
+  header->population = board->stats.population;
+  header->left = board->stats.left;
+  header->top = board->stats.top;
+  header->right = board->stats.right;
+  header->bottom = board->stats.bottom;
+  formatRule(&board->rule, header->rule, sizeof(header->rule));
+
+  // The snapshot only replaces the previous one once it is fully on disk, so
+  // a crash at any point leaves one of the two intact.
+  bool ok = false;
+  int fd = open(temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    struct iovec buffers[2] = {
+        {.iov_base = header, .iov_len = planeOffset},
+        {.iov_base = board->cells, .iov_len = planeSize},
+    };
+    ok = writeAll(fd, buffers, 2) && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+  }
+  free(header);
+
+  ok = ok && rename(temporaryPath, path) == 0 && syncDirectory(path);
+  if (!ok)
+    unlink(temporaryPath);
+  return ok;
+}
+
+static bool isValidHeader(const SnapshotHeader *header, size_t fileSize) {
+  if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+      header->version != SNAPSHOT_VERSION ||
+      header->byteOrder != SNAPSHOT_BYTE_ORDER ||
+      header->topology != SNAPSHOT_TOPOLOGY_TORUS ||
+      memchr(header->rule, '\0', sizeof(header->rule)) == nullptr)
+    return false;
+
+  if (header->width <= 0 || header->height <= 0 ||
+      header->stride != (int64_t)header->width + 2 ||
+      header->planeSize !=
+          (uint64_t)header->stride * ((uint64_t)header->height + 2))
+    return false;
+
+  // Bounds are all -1 when there are no live cells.
+  bool isEmpty = header->left == -1 && header->top == -1 &&
+                 header->right == -1 && header->bottom == -1 &&
+                 header->population == 0;
+  bool hasBounds = header->left >= 0 && header->left <= header->right &&
+                   header->right < header->width && header->top >= 0 &&
+                   header->top <= header->bottom &&
+                   header->bottom < header->height;
+  if ((!isEmpty && !hasBounds) ||
+      header->population > (uint64_t)header->width * header->height)
+    return false;
+
+  return header->planeOffset >= sizeof(SnapshotHeader) &&
+         header->planeOffset <= fileSize &&
+         header->planeSize <= fileSize - header->planeOffset;
+}
+
+bool openSnapshot(const char *path, Board *board) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat status;
+  if (fstat(fd, &status) != 0 ||
+      (size_t)status.st_size < sizeof(SnapshotHeader)) {
+    close(fd);
+    return false;
+  }
+
+  // Private mappings of read-only files are still writable. Pages are only
+  // read in as the board touches them, and copied once written.
+  size_t size = (size_t)status.st_size;
+  void *mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  const SnapshotHeader *header = mapping;
+  Rule rule;
+  if (!isValidHeader(header, size) || !parseRule(header->rule, &rule) ||
+      !fitsRuleLattice(&rule, header->width, header->height)) {
+    munmap(mapping, size);
+    return false;
+  }
+
+  SnapshotHeader saved = *header;
+  if (!initMappedBoard(board, saved.width, saved.height, &rule, mapping, size,
+                       saved.planeOffset))
+    return false;
+  board->generation = saved.generation;
+  board->hash = saved.hash;
+  board->stats = (BoardStats){
+      .population = saved.population,
+      .left = saved.left,
+      .top = saved.top,
+      .right = saved.right,
+      .bottom = saved.bottom,
+  };
+  return true;
+}
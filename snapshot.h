@@ -0,0 +1,52 @@
+#ifndef GOL_SNAPSHOT_H
+#define GOL_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "board.h"
+#include "rule.h"
+
+#define SNAPSHOT_MAGIC "GOLSNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_BYTE_ORDER 0x01020304u // Reads differently on other machines
+#define SNAPSHOT_PATH_MAX 4096
+
+typedef enum {
+  SNAPSHOT_TOPOLOGY_TORUS, // Edges wrap around to the opposite side
+} SnapshotTopology;
+
+// The start of a snapshot file. The board's current plane follows at
+// `planeOffset`, which is a multiple of the page size, as raw bytes
+// including the ghost border, so it can be mapped straight back into a board.
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t planeOffset;
+  uint64_t planeSize;
+  int32_t width, height;
+  int64_t stride;
+  uint32_t topology;
+  uint32_t reserved;
+  uint64_t generation;
+  uint64_t hash;      // Of the plane, see getWordKey
+  uint64_t population;
+  int32_t left, top, right, bottom; // See BoardStats
+  char rule[RULE_STRING_MAX];
+} SnapshotHeader;
+
+// Writes the header and the current plane of the board with a single
+// gathering write, into a temporary file that is synced and then renamed over
+// `path`. Returns false when writing fails, leaving any earlier file intact.
+bool writeSnapshot(const char *path, const Board *board);
+
+// Maps a snapshot copy-on-write and sets the board up with the mapped plane as
+// its current plane, so restoring copies nothing up front. The hash and stats
+// are taken from the header rather than read off the plane. Returns false when
+// the file isn't a valid snapshot. Cells aren't checked, since that would read
+// in the whole plane; states the rule lacks are drawn as alive and die on the
+// next step.
+bool openSnapshot(const char *path, Board *board);
+
+#endif // GOL_SNAPSHOT_H
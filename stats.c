@@ -0,0 +1,67 @@
+#include "stats.h"
+
+#include <string.h>
+#include <strings.h>
+
+bool openStatsLog(StatsLog *log, const char *path) {
+  *log = (StatsLog){0};
+  const char *extension = strrchr(path, '.');
+  if (extension && strcasecmp(extension, ".csv") == 0)
+    log->format = STATS_CSV;
+  else if (extension && strcasecmp(extension, ".json") == 0)
+    log->format = STATS_JSON;
+  else
+    return false;
+
+  log->file = fopen(path, "w");
+  if (!log->file)
+    return false;
+  if (log->format == STATS_CSV)
+    fputs("generation,population,births,deaths,left,top,right,bottom\n",
+          log->file);
+  else
+    fputs("[", log->file);
+  return true;
+}
+
+void writeStatsLog(StatsLog *log, const Board *board) {
+  if (!log->file)
+    return;
+
+  const BoardStats *stats = &board->stats;
+  unsigned long long generation = board->generation;
+  unsigned long long population = stats->population;
+  unsigned long long births = stats->births, deaths = stats->deaths;
+  if (log->format == STATS_CSV) {
+    // Empty boards have no bounds.
+    fprintf(log->file, "%llu,%llu,%llu,%llu", generation, population, births,
+            deaths);
+    if (stats->left < 0)
+      fputs(",,,,\n", log->file);
+    else
+      fprintf(log->file, ",%d,%d,%d,%d\n", stats->left, stats->top,
+              stats->right, stats->bottom);
+  } else {
+    fprintf(log->file,
+            "%s\n{\"generation\":%llu,\"population\":%llu,\"births\":%llu,"
+            "\"deaths\":%llu,\"bounds\":",
+            log->hasRows ? "," : "", generation, population, births, deaths);
+    if (stats->left < 0)
+      fputs("null}", log->file);
+    else
+      fprintf(log->file, "[%d,%d,%d,%d]}", stats->left, stats->top,
+              stats->right, stats->bottom);
+  }
+  log->hasRows = true;
+}
+
+bool closeStatsLog(StatsLog *log) {
+  if (!log->file)
+    return true;
+  if (log->format == STATS_JSON)
+    fputs("\n]\n", log->file);
+  bool written = !ferror(log->file);
+  written = fclose(log->file) == 0 && written;
+  *log = (StatsLog){0};
+  return written;
+}
@@ -0,0 +1,31 @@
+#ifndef GOL_STATS_H
+#define GOL_STATS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "board.h"
+
+typedef enum {
+  STATS_CSV,  // A header line, then a line per row
+  STATS_JSON, // An array of an object per row
+} StatsFormat;
+
+// A time series of the board's stats, a row per generation logged.
+typedef struct {
+  FILE *file;
+  StatsFormat format;
+  bool hasRows;
+} StatsLog;
+
+// Picks the format from the path's extension, .csv or .json. Returns false
+// for other formats or when the file can't be created.
+bool openStatsLog(StatsLog *log, const char *path);
+
+// Adds a row of the board's current stats. Does nothing on a closed log.
+void writeStatsLog(StatsLog *log, const Board *board);
+
+// Finishes the file. Returns false if anything failed to write.
+bool closeStatsLog(StatsLog *log);
+
+#endif // GOL_STATS_H
@@ -0,0 +1,126 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static TraceRing *_Atomic g_rings[TRACE_MAX_THREADS];
+static atomic_int g_ringCount;
+static atomic_bool g_isTracing;
+static uint64_t g_traceStart;
+
+static _Thread_local TraceRing *t_ring;
+static _Thread_local bool t_hasNoRing; // Ran out of rings or memory
+static _Thread_local const char *t_threadName;
+
+void startTracing() {
+  g_traceStart = SDL_GetPerformanceCounter();
+  atomic_store(&g_isTracing, true);
+}
+
+void nameTraceThread(const char *name) {
+  t_threadName = name;
+}
+
+// Returns the calling thread's ring, taking a free one on first use.
+static TraceRing *getThreadRing() {
+  if (t_ring || t_hasNoRing)
+    return t_ring;
+
+  int index = atomic_fetch_add(&g_ringCount, 1);
+  TraceRing *ring =
+      index < TRACE_MAX_THREADS ? calloc(1, sizeof(TraceRing)) : nullptr;
+  if (!ring) {
+    t_hasNoRing = true;
+    return nullptr;
+  }
+  ring->threadId = SDL_GetCurrentThreadID();
+  snprintf(ring->threadName, sizeof(ring->threadName), "%s",
+           t_threadName ? t_threadName : "thread");
+  atomic_store(&g_rings[index], ring);
+  t_ring = ring;
+  return ring;
+}
+
+void addTraceSpan(const char *name, uint64_t start, uint64_t end) {
+  if (!atomic_load_explicit(&g_isTracing, memory_order_relaxed))
+    return;
+  TraceRing *ring = getThreadRing();
+  if (!ring)
+    return;
+
+  uint64_t written = atomic_load_explicit(&ring->written, memory_order_relaxed);
+  ring->spans[written % TRACE_RING_SPANS] = (TraceSpan){name, start, end};
+  atomic_store_explicit(&ring->written, written + 1, memory_order_release);
+}
+
+// Writes the spans of one ring that weren't overwritten while being copied.
+static void writeRingSpans(FILE *file, TraceRing *ring, TraceSpan *copy) {
+  uint64_t written = atomic_load_explicit(&ring->written, memory_order_acquire);
+  uint64_t copied =
+      written > TRACE_RING_SPANS ? written - TRACE_RING_SPANS : 0;
+  for (uint64_t i = copied; i < written; i++)
+    copy[i - copied] = ring->spans[i % TRACE_RING_SPANS];
+
+  atomic_thread_fence(memory_order_acquire);
+  uint64_t nowWritten =
+      atomic_load_explicit(&ring->written, memory_order_relaxed);
+  // The slot of span nowWritten may be half written by now too, so the span
+  // it held is dropped along with the overwritten ones.
+  uint64_t first = copied;
+  if (nowWritten + 1 > TRACE_RING_SPANS &&
+      nowWritten + 1 - TRACE_RING_SPANS > first)
+    first = nowWritten + 1 - TRACE_RING_SPANS;
+
+  double microsecondsPerTick = 1e6 / SDL_GetPerformanceFrequency();
+  unsigned long long threadId = ring->threadId;
+  fprintf(file,
+          ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%llu,"
+          "\"args\":{\"name\":\"%s\"}}",
+          threadId, ring->threadName);
+  for (uint64_t i = first; i < written; i++) {
+    const TraceSpan *span = &copy[i - copied];
+    fprintf(file,
+            ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,"
+            "\"ts\":%.3f,\"dur\":%.3f}",
+            span->name, threadId,
+            ((double)span->start - (double)g_traceStart) * microsecondsPerTick,
+            (span->end - span->start) * microsecondsPerTick);
+  }
+}
+
+bool writeChromeTrace(const char *path) {
+  TraceSpan *copy = malloc(TRACE_RING_SPANS * sizeof(TraceSpan));
+  FILE *file = copy ? fopen(path, "wb") : nullptr;
+  if (!file) {
+    free(copy);
+    return false;
+  }
+
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+        "\"args\":{\"name\":\"game-of-life\"}}",
+        file);
+  int ringCount = atomic_load(&g_ringCount);
+  for (int i = 0; i < ringCount && i < TRACE_MAX_THREADS; i++) {
+    // Rings are published after they are set up, and never go away.
+    TraceRing *ring = atomic_load(&g_rings[i]);
+    if (ring)
+      writeRingSpans(file, ring, copy);
+  }
+  fputs("\n]}\n", file);
+
+  free(copy);
+  bool written = !ferror(file);
+  return fclose(file) == 0 && written;
+}
+
+void stopTracing() {
+  atomic_store(&g_isTracing, false);
+  int ringCount = atomic_load(&g_ringCount);
+  for (int i = 0; i < ringCount && i < TRACE_MAX_THREADS; i++)
+    free(atomic_exchange(&g_rings[i], nullptr));
+  atomic_store(&g_ringCount, 0);
+  t_ring = nullptr;
+  t_hasNoRing = false;
+}
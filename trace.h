@@ -0,0 +1,56 @@
+#ifndef GOL_TRACE_H
+#define GOL_TRACE_H
+
+#include <SDL3/SDL.h>
+#include <stdatomic.h>
+
+#define TRACE_MAX_THREADS 32
+#define TRACE_RING_SPANS 4096 // Latest spans kept of each thread
+#define TRACE_NAME_MAX 32
+
+// A timed piece of work on one thread. Names are static strings.
+typedef struct {
+  const char *name;
+  uint64_t start, end; // Performance counter ticks
+} TraceSpan;
+
+// The latest spans of one thread. Only that thread writes: it fills the slot
+// after the last span and then publishes it by bumping `written`, so spans
+// are added without locks. Readers copy the ring and drop the spans that were
+// overwritten while they copied.
+typedef struct {
+  TraceSpan spans[TRACE_RING_SPANS];
+  _Atomic uint64_t written; // Spans ever added
+  SDL_ThreadID threadId;
+  char threadName[TRACE_NAME_MAX];
+} TraceRing;
+
+// Starts keeping the spans of every thread.
+void startTracing();
+
+// Names the calling thread in traces.
+void nameTraceThread(const char *name);
+
+// Adds a span to the calling thread's ring, while tracing.
+void addTraceSpan(const char *name, uint64_t start, uint64_t end);
+
+// Writes the kept spans as Chrome Trace Event JSON, which chrome://tracing
+// and Perfetto open. Can be called while other threads keep tracing.
+bool writeChromeTrace(const char *path);
+
+// Stops tracing and frees the rings. Every traced thread must be done.
+void stopTracing();
+
+// Traces the statement or block that follows as a span. Builds without
+// GOL_PROFILE run it untraced.
+#ifdef GOL_PROFILE
+#define WITH_TRACED_SPAN(name)                                                 \
+  for (uint64_t spanStart = SDL_GetPerformanceCounter(), flag = 0;             \
+       flag != 1;                                                              \
+       addTraceSpan((name), spanStart, SDL_GetPerformanceCounter()),           \
+       flag = 1)
+#else
+#define WITH_TRACED_SPAN(name) for (bool flag = false; !flag; flag = true)
+#endif
+
+#endif // GOL_TRACE_H
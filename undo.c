@@ -0,0 +1,194 @@
+#include "undo.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool initUndoBuffer(UndoBuffer *buffer, int width) {
+  *buffer = (UndoBuffer){.width = width, .row = malloc(width)};
+  return buffer->row;
+}
+
+static size_t getEditBytes(const UndoEdit *edit) {
+  return edit->runCapacity * sizeof(UndoRun) + edit->flipCapacity;
+}
+
+static void freeEdit(UndoEdit *edit) {
+  free(edit->runs);
+  free(edit->flips);
+  *edit = (UndoEdit){0};
+}
+
+static UndoEdit *getEdit(UndoBuffer *buffer, uint64_t position) {
+  return &buffer->edits[position % UNDO_EDIT_CAPACITY];
+}
+
+void freeUndoBuffer(UndoBuffer *buffer) {
+  clearUndoBuffer(buffer);
+  free(buffer->row);
+  *buffer = (UndoBuffer){0};
+}
+
+void clearUndoBuffer(UndoBuffer *buffer) {
+  for (uint64_t i = buffer->firstEdit; i < buffer->endEdit; i++)
+    freeEdit(getEdit(buffer, i));
+  freeEdit(getEdit(buffer, buffer->endEdit));
+  buffer->firstEdit = buffer->currentEdit = buffer->endEdit;
+  buffer->usedBytes = 0;
+  buffer->isEditing = false;
+}
+
+// Forgets the oldest kept edit to make room.
+static void forgetOldestEdit(UndoBuffer *buffer) {
+  UndoEdit *oldest = getEdit(buffer, buffer->firstEdit++);
+  buffer->usedBytes -= getEditBytes(oldest);
+  freeEdit(oldest);
+}
+
+void beginEdit(UndoBuffer *buffer) {
+  // Undone edits can't be redone once something else changed.
+  for (; buffer->endEdit > buffer->currentEdit; buffer->endEdit--) {
+    UndoEdit *undone = getEdit(buffer, buffer->endEdit - 1);
+    buffer->usedBytes -= getEditBytes(undone);
+    freeEdit(undone);
+  }
+  if (buffer->endEdit - buffer->firstEdit == UNDO_EDIT_CAPACITY)
+    forgetOldestEdit(buffer);
+
+  freeEdit(getEdit(buffer, buffer->endEdit));
+  buffer->isEditing = true;
+  buffer->hasOverflow = false;
+}
+
+// Makes room for `count` more items of `size` bytes, doubling the capacity.
+static bool reserveItems(void **items, size_t *capacity, size_t count,
+                         size_t size) {
+  if (count <= *capacity)
+    return true;
+  size_t newCapacity = *capacity ? *capacity : 256;
+  while (newCapacity < count)
+    newCapacity *= 2;
+  void *grown = realloc(*items, newCapacity * size);
+  if (!grown)
+    return false;
+  *items = grown;
+  *capacity = newCapacity;
+  return true;
+}
+
+// Records a change of a cell in the open edit, extending the last run when the
+// cell follows it closely.
+static void recordChange(UndoBuffer *buffer, int x, int y, uint8_t flip) {
+  UndoEdit *edit = getEdit(buffer, buffer->endEdit);
+  uint64_t cell = (uint64_t)y * buffer->width + x;
+  UndoRun *last = edit->runCount ? &edit->runs[edit->runCount - 1] : nullptr;
+  uint64_t end = last ? last->cell + last->length : 0;
+  bool extendsLast = last && cell >= end && cell - end <= UNDO_RUN_GAP;
+  size_t gap = extendsLast ? cell - end : 0;
+
+  if (!reserveItems((void **)&edit->flips, &edit->flipCapacity,
+                    edit->flipCount + gap + 1, 1) ||
+      (!extendsLast &&
+       !reserveItems((void **)&edit->runs, &edit->runCapacity,
+                     edit->runCount + 1, sizeof(UndoRun)))) {
+    buffer->hasOverflow = true;
+    return;
+  }
+
+  memset(edit->flips + edit->flipCount, 0, gap);
+  edit->flips[edit->flipCount + gap] = flip;
+  edit->flipCount += gap + 1;
+  if (extendsLast)
+    last->length += gap + 1;
+  else
+    edit->runs[edit->runCount++] = (UndoRun){.cell = cell, .length = 1};
+}
+
+void setEditedCell(UndoBuffer *buffer, Board *board, int x, int y,
+                   uint8_t state) {
+  uint8_t flip = *getBoardCell(board, x, y) ^ state;
+  setBoardCell(board, x, y, state);
+  if (flip && buffer->isEditing && !buffer->hasOverflow)
+    recordChange(buffer, x, y, flip);
+}
+
+void setEditedRow(UndoBuffer *buffer, Board *board, int x, int y,
+                  const uint8_t *states, int count) {
+  const uint8_t *row = getBoardCell(board, x, y);
+  for (int i = 0; i < count && buffer->isEditing && !buffer->hasOverflow;
+       i += 8) {
+    int end = i + 8 < count ? i + 8 : count;
+    if (end - i == 8 && memcmp(row + i, states + i, 8) == 0)
+      continue;
+    for (int j = i; j < end; j++) {
+      if (row[j] != states[j])
+        recordChange(buffer, x + j, y, row[j] ^ states[j]);
+    }
+  }
+  setBoardRow(board, x, y, states, count);
+}
+
+bool endEdit(UndoBuffer *buffer) {
+  if (!buffer->isEditing)
+    return true;
+  buffer->isEditing = false;
+
+  // Changes that weren't recorded would be undone wrongly by the older edits
+  // too, so those are forgotten as well.
+  UndoEdit *edit = getEdit(buffer, buffer->endEdit);
+  if (buffer->hasOverflow) {
+    clearUndoBuffer(buffer);
+    return false;
+  }
+  if (edit->flipCount == 0) {
+    freeEdit(edit);
+    return true;
+  }
+
+  buffer->usedBytes += getEditBytes(edit);
+  buffer->currentEdit = ++buffer->endEdit;
+  while (buffer->usedBytes > (size_t)UNDO_MEGABYTES << 20 &&
+         buffer->endEdit - buffer->firstEdit > 1)
+    forgetOldestEdit(buffer);
+  return true;
+}
+
+// Flips every cell the edit changed, which both undoes and redoes it, a row
+// of a run at a time.
+static void flipEditedCells(UndoBuffer *buffer, Board *board,
+                            const UndoEdit *edit) {
+  const uint8_t *flips = edit->flips;
+  for (size_t i = 0; i < edit->runCount; i++) {
+    uint64_t cell = edit->runs[i].cell, left = edit->runs[i].length;
+    int x = (int)(cell % buffer->width), y = (int)(cell / buffer->width);
+    while (left > 0) {
+      int count = (uint64_t)(buffer->width - x) < left ? buffer->width - x
+                                                      : (int)left;
+      const uint8_t *row = getBoardCell(board, x, y);
+      for (int j = 0; j < count; j++)
+        buffer->row[j] = row[j] ^ flips[j];
+      setBoardRow(board, x, y, buffer->row, count);
+      flips += count;
+      left -= count;
+      x = 0;
+      y++;
+    }
+  }
+}
+
+bool undoEdit(UndoBuffer *buffer, Board *board) {
+  if (buffer->isEditing || buffer->currentEdit == buffer->firstEdit)
+    return false;
+
+  buffer->currentEdit--;
+  flipEditedCells(buffer, board, getEdit(buffer, buffer->currentEdit));
+  return true;
+}
+
+bool redoEdit(UndoBuffer *buffer, Board *board) {
+  if (buffer->isEditing || buffer->currentEdit == buffer->endEdit)
+    return false;
+
+  flipEditedCells(buffer, board, getEdit(buffer, buffer->currentEdit));
+  buffer->currentEdit++;
+  return true;
+}
@@ -0,0 +1,76 @@
+#ifndef GOL_UNDO_H
+#define GOL_UNDO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+
+#define UNDO_MEGABYTES 16       // Memory of the older edits kept at most
+#define UNDO_EDIT_CAPACITY 1024 // Edits remembered at most
+#define UNDO_RUN_GAP 8          // Unchanged cells a run spans, not to split
+
+// Consecutive changed cells, `length` of them from the row-major `cell` on,
+// with unchanged cells of short gaps in between.
+typedef struct {
+  uint64_t cell, length;
+} UndoRun;
+
+// One batch of changed cells, such as one drag or one reset. Each cell of the
+// runs has its old state XOR its new state in `flips`, in order, which undoes
+// and redoes it alike, so no copies of the board are made. Runs keep big
+// edits compact: a reset costs about a byte per live cell, and nothing for
+// the dead cells away from them.
+typedef struct {
+  UndoRun *runs;
+  size_t runCount, runCapacity;
+  uint8_t *flips;
+  size_t flipCount, flipCapacity;
+} UndoEdit;
+
+// Edits of the board, kept in a ring within a memory budget so that the
+// oldest are forgotten first. The newest edit is kept whatever its size.
+// Positions in the ring count up forever and wrap on access.
+typedef struct {
+  int width;
+  UndoEdit edits[UNDO_EDIT_CAPACITY];
+  uint64_t firstEdit;   // Oldest edit kept
+  uint64_t currentEdit; // Edits before this are done, the rest undone
+  uint64_t endEdit;     // Also the slot of the open edit
+  size_t usedBytes;     // Of the kept edits
+
+  bool isEditing;   // An edit is being recorded
+  bool hasOverflow; // Ran out of memory recording the open edit
+  uint8_t *row;     // Cells of a row being undone or redone
+} UndoBuffer;
+
+bool initUndoBuffer(UndoBuffer *buffer, int width);
+void freeUndoBuffer(UndoBuffer *buffer);
+
+// Forgets every edit, e.g. once the board moves on to another generation.
+void clearUndoBuffer(UndoBuffer *buffer);
+
+// Starts recording an edit, forgetting the edits that were undone.
+void beginEdit(UndoBuffer *buffer);
+
+// Sets a cell and records the change in the open edit.
+void setEditedCell(UndoBuffer *buffer, Board *board, int x, int y,
+                   uint8_t state);
+
+// Writes a run of cells of a row and records the ones that change, skipping
+// words of eight unchanged cells.
+void setEditedRow(UndoBuffer *buffer, Board *board, int x, int y,
+                  const uint8_t *states, int count);
+
+// Finishes the open edit. An edit that changed nothing isn't kept. Returns
+// false when there was no memory to record the edit; the older edits are then
+// forgotten too, since undoing them would take undoing this one first.
+bool endEdit(UndoBuffer *buffer);
+
+// Reverts the newest edit, or reapplies the oldest undone one. Returns false
+// when there is none.
+bool undoEdit(UndoBuffer *buffer, Board *board);
+bool redoEdit(UndoBuffer *buffer, Board *board);
+
+#endif // GOL_UNDO_H